@@ -0,0 +1,96 @@
+// Measures the overhead of `SUBCASE` per subcase met and per run of a test
+// case with 10^5 generated innermost subcases, and the throughput of passing
+// `CHECK` and `CHECK_MESSAGE`.  Kept outside of `solution` so that it is not
+// checked with the solution.  Build from `lab06-mytest` with
+// `g++ -std=c++20 -O2 -Isolution bench/mytest_bench.cpp solution/mytest.cpp
+// -o mytest_bench`.
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mytest.hpp"
+#include "mytest_internal.hpp"
+
+namespace {
+constexpr int WIDTH = 10;
+constexpr int DEPTH = 5;  // WIDTH^DEPTH innermost subcases.
+constexpr std::size_t CHECKS = 100'000'000;
+
+std::size_t subcases_met = 0;
+std::size_t runs = 0;
+
+void generate(int depth) {
+    if (depth == DEPTH) {
+        return;
+    }
+    for (int i = 0; i < WIDTH; i++) {
+        subcases_met++;
+        SUBCASE("i=" + std::to_string(i)) {
+            generate(depth + 1);
+        }
+    }
+}
+
+void wide_tree() {
+    runs++;
+    generate(0);
+}
+
+template <typename F>
+double seconds(F f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start
+    )
+        .count();
+}
+
+void bench_subcases() {
+    std::stringstream ignored;
+    std::streambuf *const cerr_buf = std::cerr.rdbuf(ignored.rdbuf());
+    bool passed = false;
+    const double ns =
+        seconds([&]() {
+            passed = mytest::run_test_case({"wide tree", wide_tree, false});
+        }) *
+        1e9;
+    std::cerr.rdbuf(cerr_buf);
+
+    std::cout << "passed: " << passed << "\n"
+              << "runs: " << runs << "\n"
+              << "subcases met: " << subcases_met << "\n"
+              << "ns per subcase met: " << ns / subcases_met << "\n"
+              << "ns per run: " << ns / runs << "\n";
+}
+
+void bench_checks() {
+    // Values the compiler cannot know, so checks are not folded.
+    std::vector<std::size_t> values(1024);
+    std::iota(values.begin(), values.end(), 0);
+    const double check = seconds([&]() {
+        for (std::size_t i = 0; i < CHECKS; i++) {
+            CHECK(values[i % values.size()] == i % values.size());
+        }
+    });
+    const double check_message = seconds([&]() {
+        for (std::size_t i = 0; i < CHECKS; i++) {
+            CHECK_MESSAGE(
+                values[i % values.size()] == i % values.size(),
+                "the value does not match its index"
+            );
+        }
+    });
+    std::cout << "CHECK per second: " << CHECKS / check << "\n"
+              << "CHECK_MESSAGE per second: " << CHECKS / check_message
+              << "\n";
+}
+}  // namespace
+
+int main() {
+    bench_subcases();
+    bench_checks();
+}
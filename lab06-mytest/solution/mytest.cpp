@@ -1,2 +1,232 @@
 #include "mytest.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <iostream>
+#include <utility>
+#include <vector>
 #include "mytest_internal.hpp"
+
+namespace mytest {
+namespace {
+// Subcases entered at least once form a trie rooted at the test case itself.
+// Children of a node are identified by their order of execution inside it,
+// and the ones before `done` are fully run, so the next subcase to enter is
+// found without comparing paths.
+struct subcase_node {
+    std::string name;
+    std::size_t parent = 0;
+    std::vector<std::size_t> children;
+    std::size_t done = 0;
+    std::size_t met = 0;  // Children met in the current run.
+    bool entered_child = false;
+    times spent;    // In all runs, only if `time_subcases`.
+    times entered;  // When the current run entered it.
+};
+
+struct run_state {
+    bool failed = false;
+    std::vector<subcase_node> nodes{1};
+    std::vector<std::size_t> path{0};  // Nodes the execution is inside now.
+    std::size_t leaf = 0;  // The last one entered, its ancestors were too.
+    bool time_subcases = false;
+};
+
+run_state &state() {
+    static run_state s;
+    return s;
+}
+
+void print_subcases(std::size_t node) {
+    if (node != 0) {
+        print_subcases(state().nodes[node].parent);
+        std::cerr << "    in subcase " << state().nodes[node].name << '\n';
+    }
+}
+}  // namespace
+
+times current_times() {
+    return {
+        std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        )
+            .count(),
+        static_cast<double>(std::clock()) / CLOCKS_PER_SEC};
+}
+
+times elapsed_since(const times &start) {
+    const times now = current_times();
+    return {now.wall - start.wall, now.cpu - start.cpu};
+}
+
+void report_failure(
+    const char *expr,
+    const char *file,
+    int line,
+    const std::string_view *message
+) {
+    state().failed = true;
+    std::cerr << "CHECK(" << expr << ") at " << file << ':' << line
+              << " failed!\n";
+    if (message != nullptr) {
+        std::cerr << "    message: " << *message << '\n';
+    }
+    print_subcases(state().leaf);
+}
+
+#ifdef MYTEST_INTERNAL_HAVE_SECTIONS
+// Defined by linkers around the section if any test case is registered.
+// NOLINTBEGIN(bugprone-reserved-identifier)
+extern "C" {
+[[gnu::weak]] extern const test_case_descriptor
+    *const __start_mytest_test_cases[];
+[[gnu::weak]] extern const test_case_descriptor
+    *const __stop_mytest_test_cases[];
+}
+// NOLINTEND(bugprone-reserved-identifier)
+#else
+namespace {
+const test_case_registrar *last_registrar = nullptr;
+}  // namespace
+
+test_case_registrar::test_case_registrar(
+    const test_case_descriptor &descriptor
+)
+    : descriptor(&descriptor), next(last_registrar) {
+    last_registrar = this;
+}
+#endif
+
+#if !defined(__GNUC__) && !defined(__clang__)
+void use_pointer(const volatile void *pointer) {
+    static const volatile void *volatile sink;
+    sink = pointer;
+}
+#endif
+
+subcase::subcase() {
+    run_state &s = state();
+    const std::size_t parent = s.path.back();
+    const std::size_t index = s.nodes[parent].met++;
+    if (s.nodes[parent].entered_child || index != s.nodes[parent].done) {
+        return;
+    }
+    s.nodes[parent].entered_child = true;
+    if (index == s.nodes[parent].children.size()) {
+        s.nodes[parent].children.push_back(s.nodes.size());
+        s.nodes.emplace_back().parent = parent;
+    }
+    const std::size_t node = s.nodes[parent].children[index];
+    s.nodes[node].met = 0;
+    s.nodes[node].entered_child = false;
+    if (s.time_subcases) {
+        s.nodes[node].entered = current_times();
+    }
+    s.path.push_back(node);
+    s.leaf = node;
+    m_entered = true;
+}
+
+subcase::~subcase() {
+    if (m_entered) {
+        run_state &s = state();
+        if (s.time_subcases) {
+            subcase_node &node = s.nodes[s.path.back()];
+            const times spent = elapsed_since(node.entered);
+            node.spent.wall += spent.wall;
+            node.spent.cpu += spent.cpu;
+        }
+        s.path.pop_back();
+    }
+}
+
+bool subcase::set_name(std::string name) const {
+    state().nodes[state().leaf].name = std::move(name);
+    return true;
+}
+
+std::vector<test_case> test_cases() {
+    std::vector<test_case> cases;
+    const auto add = [&](const test_case_descriptor &descriptor) {
+        cases.push_back(
+            {descriptor.name, descriptor.run, descriptor.benchmark}
+        );
+    };
+#ifdef MYTEST_INTERNAL_HAVE_SECTIONS
+    for (auto it = __start_mytest_test_cases; it != __stop_mytest_test_cases;
+         ++it) {
+        add(**it);
+    }
+#else
+    for (auto it = last_registrar; it != nullptr; it = it->next) {
+        add(*it->descriptor);
+    }
+    std::reverse(cases.begin(), cases.end());
+#endif
+    return cases;
+}
+
+namespace {
+// Runs `test` once per innermost subcase, starting with no subcases done and
+// reusing the nodes of subcases entered earlier.
+bool run_subcases(const test_case &test, bool announce) {
+    run_state &s = state();
+    for (subcase_node &node : s.nodes) {
+        node.done = 0;
+        node.met = 0;
+        node.entered_child = false;
+    }
+    for (;;) {
+        s.path.assign(1, 0);
+        s.leaf = 0;
+        s.nodes[0].met = 0;
+        s.nodes[0].entered_child = false;
+        test.run();
+        if (s.failed) {
+            return false;
+        }
+        // Only the entered subcases may become fully run.
+        std::size_t node = s.leaf;
+        while (node != 0 && s.nodes[node].done == s.nodes[node].met) {
+            node = s.nodes[node].parent;
+            s.nodes[node].done++;
+        }
+        if (node == 0 && s.nodes[0].done == s.nodes[0].met) {
+            return true;
+        }
+        if (announce) {
+            std::cerr << "...another subcase...\n";
+        }
+    }
+}
+}  // namespace
+
+bool run_test_case(const test_case &test, bool time_subcases) {
+    run_state &s = state();
+    s = run_state{};
+    s.time_subcases = time_subcases;
+    return run_subcases(test, true);
+}
+
+bool run_benchmark_iteration(const test_case &benchmark) {
+    run_state &s = state();
+    s.failed = false;
+    s.time_subcases = false;
+    return run_subcases(benchmark, false);
+}
+
+std::vector<subcase_times> last_subcase_times() {
+    const run_state &s = state();
+    std::vector<subcase_times> result;
+    for (std::size_t i = 1; i < s.nodes.size(); i++) {
+        subcase_times &subcase = result.emplace_back();
+        for (std::size_t node = i; node != 0; node = s.nodes[node].parent) {
+            subcase.path.push_back(s.nodes[node].name);
+        }
+        std::reverse(subcase.path.begin(), subcase.path.end());
+        subcase.spent = s.nodes[i].spent;
+    }
+    return result;
+}
+}  // namespace mytest
@@ -0,0 +1,167 @@
+#ifndef MYTEST_HPP_
+#define MYTEST_HPP_
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+namespace mytest {
+// Prints the failure and, if `message` is not null, the message.
+void report_failure(
+    const char *expr,
+    const char *file,
+    int line,
+    const std::string_view *message
+);
+
+// Passing checks only test `passed`; the message is formatted on failure.
+inline void check(bool passed, const char *expr, const char *file, int line) {
+    if (!passed) [[unlikely]] {
+        report_failure(expr, file, line, nullptr);
+    }
+}
+
+template <typename Message>
+void check(
+    bool passed,
+    const char *expr,
+    const char *file,
+    int line,
+    const Message &message
+) {
+    if (!passed) [[unlikely]] {
+        const std::string_view text(message);
+        report_failure(expr, file, line, &text);
+    }
+}
+
+// Describes a test case at compile time, so registering it runs no code
+// before `main`.
+struct test_case_descriptor {
+    void (*run)();
+    const char *name;
+    bool benchmark;
+};
+
+#if defined(__ELF__) && (defined(__GNUC__) || defined(__clang__))
+// Linkers gather pointers to all descriptors into one array.
+#define MYTEST_INTERNAL_HAVE_SECTIONS
+#else
+// Links descriptors into a list without allocating.
+struct test_case_registrar {
+    explicit test_case_registrar(const test_case_descriptor &descriptor);
+
+    const test_case_descriptor *descriptor;
+    const test_case_registrar *next;
+};
+#endif
+
+#if !defined(__GNUC__) && !defined(__clang__)
+void use_pointer(const volatile void *pointer);
+#endif
+
+// Makes the compiler assume that `value` is read, so a `BENCHMARK` computing
+// it is not optimized away.
+template <typename T>
+void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    use_pointer(&value);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Makes the compiler assume that all memory is read and written, so stores
+// in a `BENCHMARK` are not optimized away.
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Converts to `true` if the current run of the test case enters the subcase.
+// Its name is only needed then.
+class subcase {
+public:
+    subcase();
+    ~subcase();
+
+    subcase(const subcase &) = delete;
+    subcase(subcase &&) = delete;
+    subcase &operator=(const subcase &) = delete;
+    subcase &operator=(subcase &&) = delete;
+
+    explicit operator bool() const {
+        return m_entered;
+    }
+
+    // Returns `true`.
+    bool set_name(std::string name) const;
+
+private:
+    bool m_entered = false;
+};
+}  // namespace mytest
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#define MYTEST_INTERNAL_CONCAT_IMPL(a, b) a##b
+#define MYTEST_INTERNAL_CONCAT(a, b) MYTEST_INTERNAL_CONCAT_IMPL(a, b)
+
+#define CHECK(expr) \
+    ::mytest::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+#define CHECK_MESSAGE(expr, msg) \
+    ::mytest::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__, (msg))
+
+#ifdef MYTEST_INTERNAL_HAVE_SECTIONS
+#define MYTEST_INTERNAL_REGISTER(descriptor, registrar, f, name, benchmark) \
+    static constexpr ::mytest::test_case_descriptor descriptor{           \
+        f, name, benchmark};                                              \
+    [[gnu::used, gnu::section("mytest_test_cases")]] static const         \
+        ::mytest::test_case_descriptor *const registrar = &descriptor
+#else
+#define MYTEST_INTERNAL_REGISTER(descriptor, registrar, f, name, benchmark) \
+    static constexpr ::mytest::test_case_descriptor descriptor{           \
+        f, name, benchmark};                                              \
+    static const ::mytest::test_case_registrar registrar(descriptor)
+#endif
+#define MYTEST_INTERNAL_REGISTER_LINE(f, name, benchmark)       \
+    MYTEST_INTERNAL_REGISTER(                                   \
+        MYTEST_INTERNAL_CONCAT(mytest_descriptor_, __LINE__),   \
+        MYTEST_INTERNAL_CONCAT(mytest_registrar_, __LINE__), f, \
+        name, benchmark                                         \
+    )
+
+#define TEST_CASE_REGISTER(f, name) \
+    MYTEST_INTERNAL_REGISTER_LINE(f, name, false)
+
+#define MYTEST_INTERNAL_TEST_CASE(f, name) \
+    static void f();                       \
+    TEST_CASE_REGISTER(f, name);           \
+    static void f()
+#define TEST_CASE(name)                                           \
+    MYTEST_INTERNAL_TEST_CASE(                                    \
+        MYTEST_INTERNAL_CONCAT(mytest_test_case_, __LINE__), name \
+    )
+
+// The body is run many times and measured if `--benchmark` is given.
+#define MYTEST_INTERNAL_BENCHMARK(f, name)           \
+    static void f();                                 \
+    MYTEST_INTERNAL_REGISTER_LINE(f, name, true);    \
+    static void f()
+#define BENCHMARK(name)                                           \
+    MYTEST_INTERNAL_BENCHMARK(                                    \
+        MYTEST_INTERNAL_CONCAT(mytest_benchmark_, __LINE__), name \
+    )
+
+#define MYTEST_INTERNAL_SUBCASE(var, name) \
+    if (const ::mytest::subcase var; var && var.set_name(name))
+#define SUBCASE(name)                                            \
+    MYTEST_INTERNAL_SUBCASE(                                     \
+        MYTEST_INTERNAL_CONCAT(mytest_subcase_, __LINE__), name \
+    )
+// NOLINTEND(cppcoreguidelines-macro-usage)
+
+#endif  // MYTEST_HPP_
@@ -0,0 +1,47 @@
+#ifndef MYTEST_INTERNAL_HPP_
+#define MYTEST_INTERNAL_HPP_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mytest {
+struct test_case {
+    std::string_view name;
+    void (*run)();
+    bool benchmark = false;
+};
+
+// In the order of registration, read from descriptors on each call.
+std::vector<test_case> test_cases();
+
+// Wall-clock and CPU time in seconds.
+struct times {
+    double wall = 0;
+    double cpu = 0;
+};
+
+// Since an arbitrary moment.
+times current_times();
+
+times elapsed_since(const times &start);
+
+// Runs the test case once per innermost subcase until a check fails and
+// returns whether all checks passed.  Timing subcases costs a system call.
+bool run_test_case(const test_case &test, bool time_subcases = false);
+
+// Runs a benchmark once per innermost subcase like `run_test_case`, but
+// silently and without timing, and reuses the subcases found by the last run.
+bool run_benchmark_iteration(const test_case &benchmark);
+
+struct subcase_times {
+    std::vector<std::string> path;  // Names from the outermost subcase.
+    times spent;                    // In all runs of the test case.
+};
+
+// Of all subcases entered by the last `run_test_case`, in the order of the
+// first entry, with zero times unless they were timed.
+std::vector<subcase_times> last_subcase_times();
+}  // namespace mytest
+
+#endif  // MYTEST_INTERNAL_HPP_
@@ -1,14 +1,658 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "mytest.hpp"
 #include "mytest_internal.hpp"
 #ifdef _MSC_VER
 #include <crtdbg.h>
 #endif
+#if __has_include(<unistd.h>)
+#include <sys/wait.h>
+#include <unistd.h>
+#define MYTEST_INTERNAL_HAVE_FORK
+#endif
+
+namespace mytest {
+namespace {
+using clock = std::chrono::steady_clock;
+
+// Wall-clock durations in seconds.
+using durations_by_name = std::map<std::string, double, std::less<>>;
+
+struct options {
+    std::size_t jobs = 1;
+    std::size_t shard = 1;  // From 1 to `shards`.
+    std::size_t shards = 1;
+    std::optional<std::string> timings_path;
+    bool benchmarks = false;
+    std::optional<std::chrono::milliseconds> timeout;
+    std::size_t durations = 0;  // Slowest test cases and subcases to report.
+    std::optional<std::string> junit_path;
+    std::optional<std::string> json_path;
+
+    [[nodiscard]] bool time_subcases() const {
+        return durations > 0 || json_path;
+    }
+};
+
+struct outcome {
+    bool passed = false;
+    times spent;
+    // Only for test cases run by workers.
+    std::string output;
+    std::string errors;
+    std::vector<subcase_times> subcases;
+};
+
+std::optional<std::size_t> parse_positive(std::string_view s) {
+    std::size_t value = 0;
+    for (const char c : s) {
+        if (c < '0' || c > '9' || value > 1'000'000) {
+            return std::nullopt;
+        }
+        value = value * 10 + static_cast<std::size_t>(c - '0');
+    }
+    return s.empty() || value == 0 ? std::nullopt : std::optional(value);
+}
+
+std::optional<options> parse_options(const std::vector<std::string> &args) {
+    options result;
+    for (std::size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--benchmark") {
+            result.benchmarks = true;
+            continue;
+        }
+        if (i + 1 == args.size()) {
+            return std::nullopt;
+        }
+        const std::string &value = args[++i];
+        if (args[i - 1] == "--jobs" && parse_positive(value)) {
+            result.jobs = *parse_positive(value);
+        } else if (args[i - 1] == "--shard" &&
+                   value.find('/') != std::string::npos) {
+            const std::size_t slash = value.find('/');
+            const auto shard = parse_positive(value.substr(0, slash));
+            const auto shards = parse_positive(value.substr(slash + 1));
+            if (!shard || !shards || *shard > *shards) {
+                return std::nullopt;
+            }
+            result.shard = *shard;
+            result.shards = *shards;
+        } else if (args[i - 1] == "--timings") {
+            result.timings_path = value;
+        } else if (args[i - 1] == "--timeout-ms" && parse_positive(value)) {
+            result.timeout = std::chrono::milliseconds(*parse_positive(value));
+        } else if (args[i - 1] == "--durations" && parse_positive(value)) {
+            result.durations = *parse_positive(value);
+        } else if (args[i - 1] == "--junit") {
+            result.junit_path = value;
+        } else if (args[i - 1] == "--json") {
+            result.json_path = value;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+// Lines of seconds and the name of a test case after a space.
+durations_by_name read_timings(const std::string &path) {
+    durations_by_name timings;
+    std::ifstream is(path);
+    double seconds = 0;
+    std::string name;
+    while (is >> seconds && is.get() == ' ' && std::getline(is, name)) {
+        timings[name] = seconds;
+    }
+    return timings;
+}
+
+void write_timings(
+    const std::string &path,
+    const durations_by_name &timings
+) {
+    std::ofstream os(path);
+    for (const auto &[name, seconds] : timings) {
+        os << seconds << ' ' << name << '\n';
+    }
+}
+
+// Ends the process with a report unless destroyed within the timeout.  Runs
+// only in workers where they are available, so the rest of the test cases
+// and the reports are not lost.
+class watchdog {
+public:
+    watchdog(std::string name, std::chrono::milliseconds timeout)
+        : m_thread([this, name = std::move(name), timeout]() {
+              std::unique_lock lock(m_mutex);
+              const auto stop = [&]() { return m_stop; };
+              if (!m_stopped.wait_for(lock, timeout, stop)) {
+                  std::cerr << "Test case \"" << name << "\" timed out after "
+                            << timeout.count() << " ms\n";
+                  std::cerr.flush();
+                  std::fflush(nullptr);
+                  std::_Exit(EXIT_FAILURE);
+              }
+          }) {
+    }
+
+    watchdog(const watchdog &) = delete;
+    watchdog(watchdog &&) = delete;
+    watchdog &operator=(const watchdog &) = delete;
+    watchdog &operator=(watchdog &&) = delete;
+
+    ~watchdog() {
+        {
+            const std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_stopped.notify_one();
+        m_thread.join();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_stopped;
+    bool m_stop = false;
+    std::thread m_thread;  // Started after the fields above.
+};
+
+outcome run_here(const test_case &test, const options &opts) {
+    std::cerr << "Running \"" << test.name << "\"...\n";
+    std::optional<watchdog> guard;
+    if (opts.timeout) {
+        guard.emplace(std::string(test.name), *opts.timeout);
+    }
+    const times start = current_times();
+    outcome result;
+    result.passed = run_test_case(test, opts.time_subcases());
+    result.spent = elapsed_since(start);
+    result.subcases = last_subcase_times();
+    return result;
+}
+
+double median(std::vector<double> values) {
+    const auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+// Runs the body of a benchmark with all its subcases in batches, doubling
+// their size during the warm-up until a batch takes at least `SAMPLE`, and
+// reports statistics of the time per iteration over `SAMPLES` batches.  A
+// sample is an outlier if it is further from the median than 3 standard
+// deviations estimated from the median absolute deviation.
+void measure(const test_case &benchmark) {
+    using nanoseconds = std::chrono::duration<double, std::nano>;
+    constexpr std::chrono::milliseconds WARM_UP{100};
+    constexpr nanoseconds SAMPLE = std::chrono::milliseconds{1};
+    constexpr std::size_t SAMPLES = 100;
+
+    std::size_t iterations = 1;
+    const auto batch = [&]() {
+        const clock::time_point start = clock::now();
+        for (std::size_t i = 0; i < iterations; i++) {
+            run_benchmark_iteration(benchmark);
+            clobber_memory();
+        }
+        return nanoseconds(clock::now() - start);
+    };
+    for (const clock::time_point end = clock::now() + WARM_UP;;) {
+        if (batch() < SAMPLE) {
+            iterations *= 2;
+        } else if (clock::now() >= end) {
+            break;
+        }
+    }
+
+    std::vector<double> samples(SAMPLES);
+    double mean = 0;
+    for (double &sample : samples) {
+        sample = batch().count() / static_cast<double>(iterations);
+        mean += sample / SAMPLES;
+    }
+    const double middle = median(samples);
+    std::vector<double> deviations(SAMPLES);
+    for (std::size_t i = 0; i < SAMPLES; i++) {
+        deviations[i] = std::abs(samples[i] - middle);
+    }
+    const double mad = median(deviations);
+    const auto outliers = std::count_if(
+        deviations.begin(), deviations.end(),
+        [&](double deviation) { return deviation > 3 * 1.4826 * mad; }
+    );
+    std::cerr << "    mean " << mean << " ns, median " << middle << " ns, MAD "
+              << mad << " ns, " << outliers << "/" << SAMPLES
+              << " outliers, " << iterations << " iterations per sample\n";
+}
+
+#ifdef MYTEST_INTERNAL_HAVE_FORK
+struct worker {
+    std::size_t index = 0;
+    std::FILE *output = nullptr;
+    std::FILE *errors = nullptr;
+    std::FILE *report = nullptr;  // The outcome besides the output.
+    clock::time_point start;
+};
+
+std::string read_file(std::FILE *file) {
+    std::string text;
+    std::rewind(file);
+    for (int c = 0; (c = std::fgetc(file)) != EOF;) {
+        text += static_cast<char>(c);
+    }
+    std::fclose(file);
+    return text;
+}
+
+// Names are prefixed by their lengths, so they may contain anything.
+void write_report(std::FILE *file, const outcome &result) {
+    std::ostringstream os;
+    os.precision(17);
+    os << result.spent.wall << ' ' << result.spent.cpu << ' '
+       << result.subcases.size() << '\n';
+    for (const subcase_times &subcase : result.subcases) {
+        os << subcase.spent.wall << ' ' << subcase.spent.cpu << ' '
+           << subcase.path.size();
+        for (const std::string &name : subcase.path) {
+            os << ' ' << name.size() << ':' << name;
+        }
+        os << '\n';
+    }
+    const std::string text = os.str();
+    std::fwrite(text.data(), 1, text.size(), file);
+}
+
+// Keeps `result` as is if the worker was killed before writing the report.
+void read_report(const std::string &text, outcome &result) {
+    std::istringstream is(text);
+    std::size_t subcases = 0;
+    if (!(is >> result.spent.wall >> result.spent.cpu >> subcases)) {
+        return;
+    }
+    for (std::size_t i = 0; i < subcases; i++) {
+        subcase_times &subcase = result.subcases.emplace_back();
+        std::size_t depth = 0;
+        is >> subcase.spent.wall >> subcase.spent.cpu >> depth;
+        for (std::size_t j = 0; j < depth && is; j++) {
+            std::size_t length = 0;
+            char colon = 0;
+            is >> length >> colon;
+            std::string &name = subcase.path.emplace_back(length, '\0');
+            is.read(name.data(), static_cast<std::streamsize>(length));
+        }
+    }
+}
+
+// Runs every test case in a child process with its standard output and
+// error in temporary files, at most `jobs` at once, starting with the longest ones according to
+// `timings`.  Outputs are printed in the order of `tests` as soon as all
+// previous test cases are complete, so they do not depend on `jobs`.
+std::vector<outcome> run_workers(
+    const std::vector<test_case> &tests,
+    const options &opts,
+    const durations_by_name &timings
+) {
+    std::vector<std::size_t> order(tests.size());
+    std::vector<double> expected(tests.size(), 1e300);  // Unknown run first.
+    for (std::size_t i = 0; i < tests.size(); i++) {
+        order[i] = i;
+        if (const auto it = timings.find(tests[i].name); it != timings.end()) {
+            expected[i] = it->second;
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+        return expected[a] > expected[b];
+    });
+
+    std::vector<outcome> results(tests.size());
+    std::vector<bool> done(tests.size());
+    std::map<pid_t, worker> workers;
+    std::size_t started = 0;
+    std::size_t printed = 0;
+    while (printed < tests.size()) {
+        while (workers.size() < opts.jobs && started < tests.size()) {
+            const std::size_t index = order[started++];
+            std::FILE *output = std::tmpfile();
+            std::FILE *errors = std::tmpfile();
+            std::FILE *report = std::tmpfile();
+            std::cout.flush();
+            std::fflush(nullptr);
+            const pid_t pid =
+                output == nullptr || errors == nullptr || report == nullptr
+                    ? -1
+                    : fork();
+            if (pid == 0) {
+                dup2(fileno(output), STDOUT_FILENO);
+                dup2(fileno(errors), STDERR_FILENO);
+                const outcome result = run_here(tests[index], opts);
+                write_report(report, result);
+                std::cout.flush();
+                std::fflush(nullptr);
+                std::_Exit(result.passed ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            if (pid < 0) {
+                std::perror("mytest: unable to start a worker");
+                std::exit(EXIT_FAILURE);
+            }
+            workers[pid] = {index, output, errors, report, clock::now()};
+        }
+
+        int status = 0;
+        const pid_t pid = wait(&status);
+        const auto it = workers.find(pid);
+        if (it == workers.end()) {
+            continue;
+        }
+        const worker w = it->second;
+        workers.erase(it);
+        outcome &result = results[w.index];
+        result.spent.wall =
+            std::chrono::duration<double>(clock::now() - w.start).count();
+        read_report(read_file(w.report), result);
+        result.passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        result.output = read_file(w.output);
+        result.errors = read_file(w.errors);
+        if (WIFSIGNALED(status)) {
+            result.errors += "Terminated by signal " +
+                             std::to_string(WTERMSIG(status)) + "\n";
+        }
+        done[w.index] = true;
+        for (; printed < tests.size() && done[printed]; printed++) {
+            std::cout << results[printed].output << std::flush;
+            std::cerr << results[printed].errors;
+        }
+    }
+    return results;
+}
+#endif
+
+void print_durations(
+    const std::vector<test_case> &tests,
+    const std::vector<outcome> &results,
+    std::size_t count
+) {
+    std::vector<std::pair<std::string, times>> entries;
+    for (std::size_t i = 0; i < tests.size(); i++) {
+        entries.emplace_back(tests[i].name, results[i].spent);
+        for (const subcase_times &subcase : results[i].subcases) {
+            std::string name(tests[i].name);
+            for (const std::string &subcase_name : subcase.path) {
+                name += " / " + subcase_name;
+            }
+            entries.emplace_back(std::move(name), subcase.spent);
+        }
+    }
+    count = std::min(count, entries.size());
+    std::partial_sort(
+        entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(count),
+        entries.end(),
+        [](auto &a, auto &b) { return a.second.wall > b.second.wall; }
+    );
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3) << "===== Slowest " << count
+       << " of " << entries.size() << " test cases and subcases =====\n";
+    for (std::size_t i = 0; i < count; i++) {
+        os << std::setw(9) << entries[i].second.wall << " s wall"
+           << std::setw(9) << entries[i].second.cpu << " s CPU  "
+           << entries[i].first << '\n';
+    }
+    std::cerr << os.str();
+}
+
+std::string json_string(std::string_view s) {
+    std::ostringstream os;
+    os << '"' << std::hex << std::setfill('0');
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            os << "\\u" << std::setw(4)
+               << static_cast<int>(static_cast<unsigned char>(c));
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+    return os.str();
+}
+
+void write_json(
+    const std::string &path,
+    const std::vector<test_case> &tests,
+    const std::vector<outcome> &results
+) {
+    std::ofstream os(path);
+    os.precision(17);
+    os << "{\"tests\": [";
+    for (std::size_t i = 0; i < tests.size(); i++) {
+        const outcome &result = results[i];
+        os << (i == 0 ? "\n" : ",\n") << "  {\"name\": "
+           << json_string(tests[i].name)
+           << ", \"benchmark\": " << (tests[i].benchmark ? "true" : "false")
+           << ", \"passed\": " << (result.passed ? "true" : "false")
+           << ", \"wall_seconds\": " << result.spent.wall
+           << ", \"cpu_seconds\": " << result.spent.cpu;
+        if (!result.output.empty()) {
+            os << ", \"output\": " << json_string(result.output);
+        }
+        if (!result.errors.empty()) {
+            os << ", \"errors\": " << json_string(result.errors);
+        }
+        os << ", \"subcases\": [";
+        for (std::size_t j = 0; j < result.subcases.size(); j++) {
+            const subcase_times &subcase = result.subcases[j];
+            os << (j == 0 ? "" : ", ") << "{\"path\": [";
+            for (std::size_t k = 0; k < subcase.path.size(); k++) {
+                os << (k == 0 ? "" : ", ") << json_string(subcase.path[k]);
+            }
+            os << "], \"wall_seconds\": " << subcase.spent.wall
+               << ", \"cpu_seconds\": " << subcase.spent.cpu << '}';
+        }
+        os << "]}";
+    }
+    os << "\n]}\n";
+}
+
+// Characters not allowed in XML 1.0 are replaced with '?'.
+std::string xml_text(std::string_view s) {
+    std::string result;
+    for (const char c : s) {
+        if (c == '&') {
+            result += "&amp;";
+        } else if (c == '<') {
+            result += "&lt;";
+        } else if (c == '>') {
+            result += "&gt;";
+        } else if (c == '"') {
+            result += "&quot;";
+        } else if (static_cast<unsigned char>(c) < 0x20 && c != '\t' &&
+                   c != '\n' && c != '\r') {
+            result += '?';
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+void write_junit(
+    const std::string &path,
+    const std::vector<test_case> &tests,
+    const std::vector<outcome> &results
+) {
+    std::size_t failures = 0;
+    double wall = 0;
+    for (const outcome &result : results) {
+        failures += result.passed ? 0 : 1;
+        wall += result.spent.wall;
+    }
+    std::ofstream os(path);
+    os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+       << "<testsuite name=\"mytest\" tests=\"" << tests.size()
+       << "\" failures=\"" << failures << "\" time=\"" << wall << "\">\n";
+    for (std::size_t i = 0; i < tests.size(); i++) {
+        const outcome &result = results[i];
+        os << "  <testcase name=\"" << xml_text(tests[i].name) << "\" time=\""
+           << result.spent.wall << '"';
+        if (result.passed && result.output.empty() && result.errors.empty()) {
+            os << "/>\n";
+            continue;
+        }
+        os << ">\n";
+        if (!result.passed) {
+            os << "    <failure message=\"Test case failed\"/>\n";
+        }
+        if (!result.output.empty()) {
+            os << "    <system-out>" << xml_text(result.output)
+               << "</system-out>\n";
+        }
+        if (!result.errors.empty()) {
+            os << "    <system-err>" << xml_text(result.errors)
+               << "</system-err>\n";
+        }
+        os << "  </testcase>\n";
+    }
+    os << "</testsuite>\n";
+}
+
+int run(const options &opts) {
+    std::vector<test_case> tests;
+    std::vector<test_case> benchmarks;  // Run after tests, one at a time.
+    {
+        std::vector<test_case> all = test_cases();
+        std::stable_sort(all.begin(), all.end(), [](auto &a, auto &b) {
+            return a.name < b.name;
+        });
+        for (std::size_t i = opts.shard - 1; i < all.size();
+             i += opts.shards) {
+            if (!all[i].benchmark) {
+                tests.push_back(all[i]);
+            } else if (opts.benchmarks) {
+                benchmarks.push_back(all[i]);
+            }
+        }
+    }
+    durations_by_name timings;
+    if (opts.timings_path) {
+        timings = read_timings(*opts.timings_path);
+    }
+
+    std::vector<outcome> results;
+    bool in_workers = false;
+#ifdef MYTEST_INTERNAL_HAVE_FORK
+    in_workers = opts.jobs > 1 || opts.timeout;
+    if (in_workers) {
+        results = run_workers(tests, opts, timings);
+    }
+#endif
+    for (std::size_t i = results.size(); i < tests.size(); i++) {
+        results.push_back(run_here(tests[i], opts));
+    }
+    std::size_t benchmarks_passed = 0;
+    std::vector<outcome> benchmark_results;
+    for (const test_case &benchmark : benchmarks) {
+#ifdef MYTEST_INTERNAL_HAVE_FORK
+        if (in_workers) {
+            options one_at_a_time = opts;
+            one_at_a_time.jobs = 1;
+            benchmark_results.push_back(
+                run_workers({benchmark}, one_at_a_time, {})[0]
+            );
+        }
+#endif
+        if (!in_workers) {
+            benchmark_results.push_back(run_here(benchmark, opts));
+        }
+        if (benchmark_results.back().passed) {
+            benchmarks_passed++;
+            measure(benchmark);
+        }
+    }
+
+    std::size_t passed = 0;
+    for (std::size_t i = 0; i < tests.size(); i++) {
+        passed += results[i].passed ? 1 : 0;
+        timings[std::string(tests[i].name)] = results[i].spent.wall;
+    }
+    if (opts.timings_path) {
+        write_timings(*opts.timings_path, timings);
+    }
+    if (opts.json_path) {
+        // Only JSON marks benchmarks, so they are reported after the tests.
+        std::vector<test_case> reported = tests;
+        reported.insert(reported.end(), benchmarks.begin(), benchmarks.end());
+        std::vector<outcome> outcomes = results;
+        outcomes.insert(
+            outcomes.end(), benchmark_results.begin(), benchmark_results.end()
+        );
+        write_json(*opts.json_path, reported, outcomes);
+    }
+    if (opts.junit_path) {
+        write_junit(*opts.junit_path, tests, results);
+    }
+    if (opts.durations > 0) {
+        print_durations(tests, results, opts.durations);
+    }
+    std::cerr << "===== Tests passed: " << passed << "/" << tests.size()
+              << " =====\n";
+    if (!benchmarks.empty()) {
+        std::cerr << "===== Benchmarks passed: " << benchmarks_passed << "/"
+                  << benchmarks.size() << " =====\n";
+    }
+    return passed == tests.size() && benchmarks_passed == benchmarks.size()
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+}
+}  // namespace
+}  // namespace mytest
 
-int main() {
+int main(int argc, char *argv[]) {
 #ifdef _MSC_VER
     _CrtSetReportMode(_CRT_ASSERT, _CRTDBG_MODE_FILE | _CRTDBG_MODE_DEBUG);
     _CrtSetReportFile(_CRT_ASSERT, _CRTDBG_FILE_STDERR);
     _CrtSetReportMode(_CRT_ERROR, _CRTDBG_MODE_FILE | _CRTDBG_MODE_DEBUG);
     _CrtSetReportFile(_CRT_ERROR, _CRTDBG_FILE_STDERR);
 #endif
-    // WRITE CODE HERE
+    const std::optional<mytest::options> opts =
+        mytest::parse_options(std::vector<std::string>(argv + 1, argv + argc));
+    if (!opts) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--jobs N] [--shard I/N] [--timings FILE] "
+                     "[--benchmark]\n"
+                     "    [--timeout-ms N] [--durations N] [--junit FILE] "
+                     "[--json FILE]\n"
+                     "  --jobs N        run N test cases at once in "
+                     "separate processes\n"
+                     "  --shard I/N     run only every N-th test case "
+                     "starting with the I-th\n"
+                     "  --timings FILE  start the longest test cases first "
+                     "and record durations\n"
+                     "  --benchmark     also measure benchmarks\n"
+                     "  --timeout-ms N  fail a test case if it takes "
+                     "longer\n"
+                     "  --durations N   report the N slowest test cases "
+                     "and subcases\n"
+                     "  --junit FILE    write results as JUnit XML\n"
+                     "  --json FILE     write results and durations as "
+                     "JSON\n";
+        return 2;
+    }
+    return mytest::run(*opts);
 }
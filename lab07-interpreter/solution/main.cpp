@@ -1,18 +1,252 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "matrix.hpp"
+#include "profiler.hpp"
 #ifdef _MSC_VER
 #include <crtdbg.h>
 #endif
 
 namespace matrix_interpreter {
-// TODO
+struct interpreter_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct unknown_command final : interpreter_error {
+    explicit unknown_command(const std::string &command)
+        : interpreter_error("Unknown command: '" + command + "'") {
+    }
+};
+
+struct invalid_command_format final : interpreter_error {
+    invalid_command_format() : interpreter_error("Invalid command format") {
+    }
+};
+
+struct not_a_register final : interpreter_error {
+    explicit not_a_register(const std::string &token)
+        : interpreter_error("'" + token + "' is not a register") {
+    }
+};
+
+struct unable_to_open_file final : interpreter_error {
+    explicit unable_to_open_file(const std::string &file_name)
+        : interpreter_error("Unable to open file '" + file_name + "'") {
+    }
+};
+
+namespace {
+std::vector<std::string> split_tokens(const std::string &line) {
+    std::istringstream is(line);
+    std::vector<std::string> tokens;
+    for (std::string token; is >> token;) {
+        tokens.push_back(std::move(token));
+    }
+    return tokens;
+}
+
+void expect_arguments(const std::vector<std::string> &tokens, std::size_t n) {
+    if (tokens.size() != n + 1) {
+        throw invalid_command_format();
+    }
+}
+
+std::size_t parse_register(const std::string &token) {
+    if (token.size() != 2 || token[0] != '$' ||
+        std::isdigit(static_cast<unsigned char>(token[1])) == 0) {
+        throw not_a_register(token);
+    }
+    return static_cast<std::size_t>(token[1] - '0');
+}
+
+std::size_t parse_index(const std::string &token) {
+    const std::size_t max_index = 1'000'000;
+    std::size_t result = 0;
+    if (token.empty()) {
+        throw invalid_command_format();
+    }
+    for (const char c : token) {
+        if (std::isdigit(static_cast<unsigned char>(c)) == 0) {
+            throw invalid_command_format();
+        }
+        result = result * 10 + static_cast<std::size_t>(c - '0');
+        if (result > max_index) {
+            throw invalid_command_format();
+        }
+    }
+    return result;
+}
+
+bool is_profiled(const std::string &command) {
+    const std::array<std::string_view, 5> profiled = {
+        "load", "print", "elem", "add", "mul"};
+    return std::find(profiled.begin(), profiled.end(), command) !=
+           profiled.end();
+}
+
+std::uint64_t elements(const matrix &m) noexcept {
+    return static_cast<std::uint64_t>(m.rows()) * m.cols();
+}
+
+std::size_t element_bytes(std::size_t rows, std::size_t cols) noexcept {
+    return rows * cols * sizeof(int);
+}
+
+// What a command did, for the profiler.
+struct work {
+    std::uint64_t flops = 0;  // FLOP-equivalents.
+    std::size_t allocated_bytes = 0;  // By new matrices.
+};
+
+class interpreter {
+public:
+    work execute(const std::vector<std::string> &tokens) {
+        const std::string &command = tokens[0];
+        if (command == "load") {
+            expect_arguments(tokens, 2);
+            matrix &target = m_registers[parse_register(tokens[1])];
+            std::ifstream file(tokens[2]);
+            if (!file) {
+                throw unable_to_open_file(tokens[2]);
+            }
+            file >> target;
+            return {
+                elements(target), element_bytes(target.rows(), target.cols())};
+        } else if (command == "print") {
+            expect_arguments(tokens, 1);
+            const matrix &m = m_registers[parse_register(tokens[1])];
+            std::cout << m;
+            return {elements(m)};
+        } else if (command == "elem") {
+            expect_arguments(tokens, 3);
+            const matrix &m = m_registers[parse_register(tokens[1])];
+            std::cout << m.at(parse_index(tokens[2]), parse_index(tokens[3]))
+                      << '\n';
+            return {1};
+        } else if (command == "add") {
+            expect_arguments(tokens, 2);
+            matrix &lhs = m_registers[parse_register(tokens[1])];
+            const matrix &rhs = m_registers[parse_register(tokens[2])];
+            lhs += rhs;
+            return {elements(lhs)};
+        } else if (command == "mul") {
+            expect_arguments(tokens, 2);
+            matrix &lhs = m_registers[parse_register(tokens[1])];
+            const matrix &rhs = m_registers[parse_register(tokens[2])];
+            const work done{
+                2 * elements(lhs) * rhs.cols(),
+                element_bytes(lhs.rows(), rhs.cols())};
+            lhs *= rhs;
+            return done;
+        }
+        throw unknown_command(command);
+    }
+
+    [[nodiscard]] std::size_t matrix_bytes() const noexcept {
+        std::size_t bytes = 0;
+        for (const matrix &m : m_registers) {
+            bytes += element_bytes(m.rows(), m.cols());
+        }
+        return bytes;
+    }
+
+private:
+    std::array<matrix, 10> m_registers;
+};
+
+void run(std::optional<profiler> &prof) {
+    interpreter interp;
+    std::size_t line_number = 0;
+    for (std::string line; std::getline(std::cin, line);) {
+        line_number++;
+        try {
+            const std::vector<std::string> tokens = split_tokens(line);
+            if (tokens.empty()) {
+                continue;
+            }
+            if (tokens[0] == "exit") {
+                expect_arguments(tokens, 0);
+                break;
+            }
+            if (!prof || !is_profiled(tokens[0])) {
+                interp.execute(tokens);
+                continue;
+            }
+            profiler::scope scope(
+                *prof, tokens[0], line_number, interp.matrix_bytes()
+            );
+            const work done = interp.execute(tokens);
+            scope.add_flops(done.flops);
+            scope.record_memory(done.allocated_bytes, interp.matrix_bytes());
+        } catch (const std::bad_alloc &) {
+            std::cout << "Unable to allocate memory\n";
+        } catch (const std::exception &e) {
+            std::cout << e.what() << '\n';
+        }
+    }
+}
+}  // namespace
 }  // namespace matrix_interpreter
 
-int main() {
+int main(int argc, char *argv[]) {
 #ifdef _MSC_VER
     _CrtSetReportMode(_CRT_ASSERT, _CRTDBG_MODE_FILE | _CRTDBG_MODE_DEBUG);
     _CrtSetReportFile(_CRT_ASSERT, _CRTDBG_FILE_STDERR);
     _CrtSetReportMode(_CRT_ERROR, _CRTDBG_MODE_FILE | _CRTDBG_MODE_DEBUG);
     _CrtSetReportFile(_CRT_ERROR, _CRTDBG_FILE_STDERR);
 #endif
-    // TODO
+    using matrix_interpreter::profiler;
+
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
+    const std::string_view profile_flag = "--profile";
+    std::optional<profiler> prof;
+    std::optional<std::string> trace_file;
+    for (const std::string_view arg : args) {
+        if (arg == profile_flag) {
+            prof.emplace();
+        } else if (arg.starts_with(profile_flag) &&
+                   arg[profile_flag.size()] == '=') {
+            prof.emplace();
+            trace_file = arg.substr(profile_flag.size() + 1);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--profile[=<trace.json>]]\n";
+            return 1;
+        }
+    }
+
+    // Opened before the script runs so that a bad path fails right away.
+    std::ofstream trace;
+    if (trace_file) {
+        trace.open(*trace_file);
+        if (!trace) {
+            std::cerr << "Unable to open file '" << *trace_file << "'\n";
+            return 1;
+        }
+    }
+
+    matrix_interpreter::run(prof);
+
+    if (prof) {
+        prof->print_summary(std::cerr);
+    }
+    if (trace_file) {
+        prof->write_trace(trace);
+        trace.close();
+        if (!trace) {
+            std::cerr << "Unable to write file '" << *trace_file << "'\n";
+            return 1;
+        }
+    }
 }
@@ -1,5 +1,112 @@
 #include "matrix.hpp"
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
 
 namespace matrix_interpreter {
-// TODO
+invalid_file_format::invalid_file_format()
+    : matrix_error("Invalid file format") {
+}
+
+out_of_bounds::out_of_bounds()
+    : matrix_error("Requested element is out of bounds") {
+}
+
+dimension_mismatch::dimension_mismatch(std::size_t lhs, std::size_t rhs)
+    : matrix_error(
+          "Dimension mismatch: lhs=" + std::to_string(lhs) +
+          ", rhs=" + std::to_string(rhs)
+      ) {
+}
+
+matrix::matrix(std::size_t rows, std::size_t cols)
+    : m_rows(rows == 0 || cols == 0 ? 0 : rows),
+      m_cols(rows == 0 || cols == 0 ? 0 : cols),
+      m_data(m_rows * m_cols) {
+}
+
+int &matrix::at(std::size_t row, std::size_t col) {
+    if (row >= m_rows || col >= m_cols) {
+        throw out_of_bounds();
+    }
+    return m_data[row * m_cols + col];
+}
+
+const int &matrix::at(std::size_t row, std::size_t col) const {
+    if (row >= m_rows || col >= m_cols) {
+        throw out_of_bounds();
+    }
+    return m_data[row * m_cols + col];
+}
+
+matrix &matrix::operator+=(const matrix &other) {
+    if (m_rows != other.m_rows) {
+        throw dimension_mismatch(m_rows, other.m_rows);
+    }
+    if (m_cols != other.m_cols) {
+        throw dimension_mismatch(m_cols, other.m_cols);
+    }
+    for (std::size_t i = 0; i < m_data.size(); i++) {
+        m_data[i] += other.m_data[i];
+    }
+    return *this;
+}
+
+matrix &matrix::operator*=(const matrix &other) {
+    if (m_cols != other.m_rows) {
+        throw dimension_mismatch(m_cols, other.m_rows);
+    }
+    matrix result(m_rows, other.m_cols);
+    for (std::size_t i = 0; i < m_rows; i++) {
+        int *result_row = &result.m_data[i * result.m_cols];
+        for (std::size_t k = 0; k < m_cols; k++) {
+            const int factor = m_data[i * m_cols + k];
+            const int *other_row = &other.m_data[k * other.m_cols];
+            for (std::size_t j = 0; j < other.m_cols; j++) {
+                result_row[j] += factor * other_row[j];
+            }
+        }
+    }
+    return *this = std::move(result);
+}
+
+matrix operator+(matrix lhs, const matrix &rhs) {
+    lhs += rhs;
+    return lhs;
+}
+
+matrix operator*(matrix lhs, const matrix &rhs) {
+    lhs *= rhs;
+    return lhs;
+}
+
+std::istream &operator>>(std::istream &is, matrix &m) {
+    std::size_t rows = 0;
+    std::size_t cols = 0;
+    if (!(is >> rows >> cols)) {
+        throw invalid_file_format();
+    }
+    matrix result(rows, cols);
+    for (int &element : result.m_data) {
+        if (!(is >> element)) {
+            throw invalid_file_format();
+        }
+    }
+    m = std::move(result);
+    return is;
+}
+
+std::ostream &operator<<(std::ostream &os, const matrix &m) {
+    for (std::size_t row = 0; row < m.m_rows; row++) {
+        for (std::size_t col = 0; col < m.m_cols; col++) {
+            if (col > 0) {
+                os << ' ';
+            }
+            os << m.m_data[row * m.m_cols + col];
+        }
+        os << '\n';
+    }
+    return os;
+}
 }  // namespace matrix_interpreter
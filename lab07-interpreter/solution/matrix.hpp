@@ -0,0 +1,58 @@
+#ifndef MATRIX_HPP_
+#define MATRIX_HPP_
+
+#include <cstddef>
+#include <iosfwd>
+#include <stdexcept>
+#include <vector>
+
+namespace matrix_interpreter {
+struct matrix_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct invalid_file_format final : matrix_error {
+    invalid_file_format();
+};
+
+struct out_of_bounds final : matrix_error {
+    out_of_bounds();
+};
+
+struct dimension_mismatch final : matrix_error {
+    dimension_mismatch(std::size_t lhs, std::size_t rhs);
+};
+
+class matrix {
+public:
+    matrix() = default;
+    matrix(std::size_t rows, std::size_t cols);
+
+    [[nodiscard]] std::size_t rows() const noexcept {
+        return m_rows;
+    }
+
+    [[nodiscard]] std::size_t cols() const noexcept {
+        return m_cols;
+    }
+
+    [[nodiscard]] int &at(std::size_t row, std::size_t col);
+    [[nodiscard]] const int &at(std::size_t row, std::size_t col) const;
+
+    matrix &operator+=(const matrix &other);
+    matrix &operator*=(const matrix &other);
+
+    friend std::istream &operator>>(std::istream &is, matrix &m);
+    friend std::ostream &operator<<(std::ostream &os, const matrix &m);
+
+private:
+    std::size_t m_rows = 0;
+    std::size_t m_cols = 0;
+    std::vector<int> m_data;
+};
+
+[[nodiscard]] matrix operator+(matrix lhs, const matrix &rhs);
+[[nodiscard]] matrix operator*(matrix lhs, const matrix &rhs);
+}  // namespace matrix_interpreter
+
+#endif  // MATRIX_HPP_
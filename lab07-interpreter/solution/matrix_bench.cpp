@@ -0,0 +1,319 @@
+// Benchmarks for `matrix_interpreter::matrix`.  The output mimics Google
+// Benchmark, including its JSON format, so the usual comparison tools work,
+// but there are no external dependencies and all data is generated in-process
+// from a fixed seed.
+//
+// Build without sanitizers for meaningful numbers:
+//     cmake -S . -B build-bench -DCMAKE_BUILD_TYPE=Release -DEXTRA_CXX_FLAGS=
+//     cmake --build build-bench --target matrix-bench
+//     ./build-bench/matrix-bench --benchmark_out=bench.json
+//
+// Options:
+//     --benchmark_filter=<substring>  run only benchmarks containing it
+//     --benchmark_min_time=<seconds>  minimal total time per benchmark
+//     --benchmark_out=<file>          write JSON results to the file
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <system_error>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "matrix.hpp"
+
+namespace matrix_interpreter {
+namespace {
+template <typename T>
+void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink = nullptr;
+    sink = &value;
+#endif
+}
+
+// Same sequence on every platform, unlike `std::uniform_int_distribution`.
+class generator {
+public:
+    explicit generator(std::uint64_t seed) : m_state(seed) {
+    }
+
+    int next_element() noexcept {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<int>((m_state >> 33) % 201) - 100;
+    }
+
+private:
+    std::uint64_t m_state;
+};
+
+matrix make_matrix(std::size_t rows, std::size_t cols, std::uint64_t seed) {
+    generator gen(seed);
+    matrix m(rows, cols);
+    for (std::size_t row = 0; row < rows; row++) {
+        for (std::size_t col = 0; col < cols; col++) {
+            m.at(row, col) = gen.next_element();
+        }
+    }
+    return m;
+}
+
+std::string to_text(const matrix &m) {
+    std::ostringstream os;
+    os << m.rows() << ' ' << m.cols() << '\n' << m;
+    return os.str();
+}
+
+struct null_buffer final : std::streambuf {
+    int_type overflow(int_type c) final {
+        return c;
+    }
+
+    std::streamsize xsputn(const char *, std::streamsize count) final {
+        return count;
+    }
+};
+
+struct benchmark {
+    std::string name;
+    // Work done by a single iteration, reported as `items_per_second`.
+    std::uint64_t items;
+    std::function<void()> iteration;
+};
+
+struct result {
+    std::string name;
+    std::uint64_t iterations;
+    double real_ns;
+    double cpu_ns;
+    double items_per_second;
+};
+
+result run_benchmark(const benchmark &b, double min_time) {
+    using clock = std::chrono::steady_clock;
+    b.iteration();  // Warm up caches and the allocator.
+    for (std::uint64_t iterations = 1;; iterations *= 2) {
+        const std::clock_t cpu_start = std::clock();
+        const clock::time_point start = clock::now();
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            b.iteration();
+        }
+        const double real_s =
+            std::chrono::duration<double>(clock::now() - start).count();
+        const double cpu_s =
+            static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        if (real_s >= min_time || iterations >= (1ULL << 40)) {
+            const auto n = static_cast<double>(iterations);
+            return {
+                b.name, iterations, real_s * 1e9 / n, cpu_s * 1e9 / n,
+                static_cast<double>(b.items) * n / real_s};
+        }
+    }
+}
+
+void write_json_string(std::ostream &os, std::string_view s) {
+    os << '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\';
+        }
+        os << c;
+    }
+    os << '"';
+}
+
+void write_json(std::ostream &os, const std::vector<result> &results) {
+    const std::time_t now = std::time(nullptr);
+    char date[32]{};
+    std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S", std::gmtime(&now));
+    os << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << date << "Z\",\n"
+       << "    \"executable\": \"matrix-bench\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\"\n"
+#else
+       << "    \"library_build_type\": \"debug\"\n"
+#endif
+       << "  },\n  \"benchmarks\": [";
+    bool first = true;
+    for (const result &r : results) {
+        os << (first ? "\n" : ",\n") << "    {\"name\": ";
+        first = false;
+        write_json_string(os, r.name);
+        os << ", \"run_name\": ";
+        write_json_string(os, r.name);
+        os << ", \"run_type\": \"iteration\", \"iterations\": " << r.iterations
+           << std::setprecision(17) << ", \"real_time\": " << r.real_ns
+           << ", \"cpu_time\": " << r.cpu_ns << ", \"time_unit\": \"ns\""
+           << ", \"items_per_second\": " << r.items_per_second << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+std::vector<benchmark> make_benchmarks() {
+    std::vector<benchmark> result;
+    const auto elements = [](const matrix &m) {
+        return static_cast<std::uint64_t>(m.rows()) * m.cols();
+    };
+
+    for (const std::size_t n : {16U, 128U, 1024U}) {
+        const std::string suffix = "/" + std::to_string(n);
+        const std::uint64_t items = static_cast<std::uint64_t>(n) * n;
+        result.push_back({"construct" + suffix, items, [n]() {
+                              matrix m(n, n);
+                              do_not_optimize(m);
+                          }});
+
+        auto source = std::make_shared<matrix>(make_matrix(n, n, n));
+        result.push_back({"copy" + suffix, items, [source]() {
+                              matrix m = *source;
+                              do_not_optimize(m);
+                          }});
+        result.push_back({"move" + suffix, 1, [source]() {
+                              matrix m = std::move(*source);
+                              do_not_optimize(m);
+                              *source = std::move(m);
+                          }});
+
+        // Adds `x` and then `-x` so elements never overflow.
+        auto lhs = std::make_shared<matrix>(make_matrix(n, n, n + 1));
+        auto negated = std::make_shared<matrix>(*source);
+        for (std::size_t row = 0; row < n; row++) {
+            for (std::size_t col = 0; col < n; col++) {
+                negated->at(row, col) = -negated->at(row, col);
+            }
+        }
+        result.push_back({"add" + suffix, 2 * items, [lhs, source, negated]() {
+                              *lhs += *source;
+                              *lhs += *negated;
+                              do_not_optimize(*lhs);
+                          }});
+
+        auto text = std::make_shared<std::string>(to_text(*source));
+        result.push_back({"load" + suffix, items, [text]() {
+                              std::istringstream is(*text);
+                              matrix m;
+                              is >> m;
+                              do_not_optimize(m);
+                          }});
+        result.push_back({"print" + suffix, items, [source]() {
+                              null_buffer buf;
+                              std::ostream os(&buf);
+                              os << *source;
+                          }});
+    }
+
+    const auto add_mul = [&](const std::string &name, std::size_t n,
+                             std::size_t m, std::size_t k) {
+        auto lhs = std::make_shared<matrix>(make_matrix(n, m, n * m));
+        auto rhs = std::make_shared<matrix>(make_matrix(m, k, m * k + 1));
+        result.push_back(
+            {name, 2 * elements(*lhs) * k, [lhs, rhs]() {
+                 matrix product = *lhs * *rhs;
+                 do_not_optimize(product);
+             }}
+        );
+    };
+    for (const std::size_t n : {16U, 64U, 256U}) {
+        add_mul("mul/square/" + std::to_string(n), n, n, n);
+    }
+    add_mul("mul/tall_skinny/4096x16*16x16", 4096, 16, 16);
+    add_mul("mul/tall_skinny/16x4096*4096x16", 16, 4096, 16);
+    add_mul("mul/row_by_column/65536", 1, 65536, 1);
+    add_mul("mul/column_by_row/256", 256, 1, 256);
+    return result;
+}
+
+// A positive number of seconds, optionally followed by `s` as in Google
+// Benchmark.
+bool parse_seconds(std::string_view s, double &seconds) {
+    if (s.ends_with('s')) {
+        s.remove_suffix(1);
+    }
+    double value = 0;
+    const auto [end, error] =
+        std::from_chars(s.data(), s.data() + s.size(), value);
+    if (error != std::errc() || end != s.data() + s.size() ||
+        !(value > 0 && value < 1e9)) {
+        return false;
+    }
+    seconds = value;
+    return true;
+}
+}  // namespace
+}  // namespace matrix_interpreter
+
+int main(int argc, char *argv[]) {
+    using namespace std::string_view_literals;
+    std::string filter;
+    std::string out_file;
+    double min_time = 0.5;
+    for (const std::string_view arg :
+         std::vector<std::string_view>(argv + 1, argv + argc)) {
+        const auto value_of = [&](std::string_view flag) {
+            return arg.substr(flag.size());
+        };
+        bool ok = true;
+        if (arg.starts_with("--benchmark_filter="sv)) {
+            filter = value_of("--benchmark_filter="sv);
+        } else if (arg.starts_with("--benchmark_out="sv)) {
+            out_file = value_of("--benchmark_out="sv);
+        } else if (arg.starts_with("--benchmark_min_time="sv)) {
+            ok = matrix_interpreter::parse_seconds(
+                value_of("--benchmark_min_time="sv), min_time
+            );
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--benchmark_filter=<substring>]"
+                         " [--benchmark_min_time=<seconds>]"
+                         " [--benchmark_out=<file.json>]\n";
+            return 1;
+        }
+    }
+
+    std::vector<matrix_interpreter::result> results;
+    std::cout << std::left << std::setw(36) << "Benchmark" << std::right
+              << std::setw(16) << "Time, ns" << std::setw(16) << "CPU, ns"
+              << std::setw(14) << "Iterations" << std::setw(16) << "items/s"
+              << '\n';
+    for (const auto &b : matrix_interpreter::make_benchmarks()) {
+        if (b.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        const auto &r =
+            results.emplace_back(matrix_interpreter::run_benchmark(b, min_time)
+            );
+        std::cout << std::left << std::setw(36) << r.name << std::right
+                  << std::fixed << std::setprecision(0) << std::setw(16)
+                  << r.real_ns << std::setw(16) << r.cpu_ns << std::setw(14)
+                  << r.iterations << std::setw(16) << std::scientific
+                  << std::setprecision(3) << r.items_per_second
+                  << std::defaultfloat << '\n';
+    }
+
+    if (!out_file.empty()) {
+        std::ofstream out(out_file);
+        if (!out) {
+            std::cerr << "Unable to open file '" << out_file << "'\n";
+            return 1;
+        }
+        matrix_interpreter::write_json(out, results);
+    }
+}
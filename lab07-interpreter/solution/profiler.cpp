@@ -0,0 +1,159 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <ostream>
+#include <utility>
+
+namespace matrix_interpreter {
+namespace {
+long long to_us(profiler::clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void write_json_string(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+               << static_cast<int>(c) << std::dec << std::setfill(' ');
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+}  // namespace
+
+profiler::profiler() : m_start(clock::now()) {
+}
+
+profiler::scope::scope(
+    profiler &owner,
+    std::string command,
+    std::size_t line,
+    std::size_t live_matrix_bytes
+)
+    : m_owner(owner), m_start(clock::now()), m_live_before(live_matrix_bytes) {
+    m_sample.command = std::move(command);
+    m_sample.line = line;
+    m_sample.start = m_start - owner.m_start;
+    m_sample.peak_matrix_bytes = live_matrix_bytes;
+    m_sample.live_matrix_bytes = live_matrix_bytes;
+}
+
+void profiler::scope::record_memory(
+    std::size_t allocated_bytes,
+    std::size_t live_matrix_bytes
+) noexcept {
+    m_sample.allocated_bytes += allocated_bytes;
+    m_sample.peak_matrix_bytes = std::max(
+        m_live_before + m_sample.allocated_bytes, live_matrix_bytes
+    );
+    m_sample.live_matrix_bytes = live_matrix_bytes;
+}
+
+profiler::scope::~scope() {
+    m_sample.duration = clock::now() - m_start;
+    try {
+        m_owner.m_samples.push_back(std::move(m_sample));
+    } catch (const std::bad_alloc &) {
+        // Losing a sample is better than terminating the interpreter.
+    }
+}
+
+void profiler::print_summary(std::ostream &os) const {
+    struct totals {
+        std::size_t calls = 0;
+        clock::duration time{};
+        clock::duration max_time{};
+        std::size_t allocated_bytes = 0;
+        std::size_t peak_matrix_bytes = 0;
+        std::uint64_t flops = 0;
+    };
+
+    std::map<std::string, totals> by_command;
+    for (const sample &s : m_samples) {
+        totals &t = by_command[s.command];
+        t.calls++;
+        t.time += s.duration;
+        t.max_time = std::max(t.max_time, s.duration);
+        t.allocated_bytes += s.allocated_bytes;
+        t.peak_matrix_bytes =
+            std::max(t.peak_matrix_bytes, s.peak_matrix_bytes);
+        t.flops += s.flops;
+    }
+    std::vector<std::pair<std::string, totals>> sorted(
+        by_command.begin(), by_command.end()
+    );
+    std::stable_sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+        return a.second.time > b.second.time;
+    });
+
+    os << "===== Profile by command =====\n";
+    os << std::left << std::setw(8) << "command" << std::right
+       << std::setw(8) << "calls" << std::setw(14) << "total us"
+       << std::setw(12) << "max us" << std::setw(16) << "alloc bytes"
+       << std::setw(16) << "peak bytes" << std::setw(16) << "flop-eq"
+       << '\n';
+    for (const auto &[command, t] : sorted) {
+        os << std::left << std::setw(8) << command << std::right
+           << std::setw(8) << t.calls << std::setw(14) << to_us(t.time)
+           << std::setw(12) << to_us(t.max_time) << std::setw(16)
+           << t.allocated_bytes << std::setw(16) << t.peak_matrix_bytes
+           << std::setw(16) << t.flops << '\n';
+    }
+
+    const std::size_t slowest_count = 10;
+    std::vector<const sample *> slowest;
+    slowest.reserve(m_samples.size());
+    for (const sample &s : m_samples) {
+        slowest.push_back(&s);
+    }
+    const auto slowest_end =
+        slowest.begin() +
+        static_cast<std::ptrdiff_t>(std::min(slowest.size(), slowest_count));
+    std::partial_sort(
+        slowest.begin(), slowest_end, slowest.end(),
+        [](const sample *a, const sample *b) {
+            return a->duration > b->duration;
+        }
+    );
+
+    os << "===== Slowest lines =====\n";
+    os << std::setw(8) << "line" << ' ' << std::left << std::setw(8)
+       << "command" << std::right << std::setw(14) << "us"
+       << std::setw(16) << "alloc bytes" << std::setw(16) << "peak bytes"
+       << std::setw(16) << "flop-eq" << '\n';
+    for (auto it = slowest.begin(); it != slowest_end; ++it) {
+        const sample &s = **it;
+        os << std::setw(8) << s.line << ' ' << std::left << std::setw(8)
+           << s.command << std::right << std::setw(14) << to_us(s.duration)
+           << std::setw(16) << s.allocated_bytes << std::setw(16)
+           << s.peak_matrix_bytes << std::setw(16) << s.flops << '\n';
+    }
+}
+
+void profiler::write_trace(std::ostream &os) const {
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const sample &s : m_samples) {
+        os << (first ? "" : ",\n") << "{\"name\":";
+        first = false;
+        write_json_string(os, s.command);
+        os << ",\"cat\":\"command\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+           << ",\"ts\":" << to_us(s.start) << ",\"dur\":" << to_us(s.duration)
+           << ",\"args\":{\"line\":" << s.line
+           << ",\"allocated_bytes\":" << s.allocated_bytes
+           << ",\"peak_matrix_bytes\":" << s.peak_matrix_bytes
+           << ",\"flop_eq\":" << s.flops << "}},\n"
+           << "{\"name\":\"matrix memory\",\"ph\":\"C\",\"pid\":1"
+           << ",\"ts\":" << to_us(s.start + s.duration)
+           << ",\"args\":{\"live_bytes\":" << s.live_matrix_bytes << "}}";
+    }
+    os << "\n]}\n";
+}
+}  // namespace matrix_interpreter
@@ -0,0 +1,80 @@
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace matrix_interpreter {
+// Records one sample per executed command: wall time, bytes allocated for
+// matrices, peak resident matrix memory and FLOP-equivalents (element
+// operations: additions and multiplications, elements parsed or printed).
+// Memory is reported by the interpreter, which knows the sizes of its
+// matrices.
+class profiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct sample {
+        std::string command;
+        std::size_t line = 0;
+        clock::duration start{};
+        clock::duration duration{};
+        std::size_t allocated_bytes = 0;
+        std::size_t peak_matrix_bytes = 0;
+        std::size_t live_matrix_bytes = 0;
+        std::uint64_t flops = 0;
+    };
+
+    class scope {
+    public:
+        scope(
+            profiler &owner,
+            std::string command,
+            std::size_t line,
+            std::size_t live_matrix_bytes
+        );
+        scope(const scope &) = delete;
+        scope(scope &&) = delete;
+        scope &operator=(const scope &) = delete;
+        scope &operator=(scope &&) = delete;
+        ~scope();
+
+        void add_flops(std::uint64_t flops) noexcept {
+            m_sample.flops += flops;
+        }
+
+        // Matrices allocated by the command live together with the ones
+        // before it until it finishes.
+        void record_memory(
+            std::size_t allocated_bytes,
+            std::size_t live_matrix_bytes
+        ) noexcept;
+
+    private:
+        profiler &m_owner;
+        sample m_sample;
+        clock::time_point m_start;
+        std::size_t m_live_before;
+    };
+
+    profiler();
+
+    // Prints per-command totals and the slowest lines, both sorted by wall
+    // time, slowest first.
+    void print_summary(std::ostream &os) const;
+
+    // Chrome trace-event format, can be opened by `chrome://tracing` or
+    // https://ui.perfetto.dev/ without uploading anything.
+    void write_trace(std::ostream &os) const;
+
+private:
+    clock::time_point m_start;
+    std::vector<sample> m_samples;
+};
+}  // namespace matrix_interpreter
+
+#endif  // PROFILER_HPP_
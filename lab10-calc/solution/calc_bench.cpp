@@ -0,0 +1,726 @@
+// Measures the calc library on deterministic inputs: single expressions with
+// each API, columns row by row and in blocks, very deeply nested expressions
+// and generated corpora of lines through `calc_evaluate` and through
+// `calc-cli`.  Build without sanitizers
+// for meaningful numbers:
+//     cmake -S . -B build-bench -DCMAKE_BUILD_TYPE=Release -DEXTRA_CXX_FLAGS=
+//     cmake --build build-bench --target calc-bench calc-cli
+//     ./build-bench/calc-bench [--json] [--evaluations N] [--corpus-size BYTES]
+//                              [--cli PATH]
+// `--json` prints a single JSON object instead of tables, for tracking the
+// numbers across commits.  `calc-cli` is looked up next to `calc-bench`
+// unless `--cli` is given; the CLI rows are skipped if it cannot be run.
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "calc.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_POSIX
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Keeps results observable so that loops are not optimized out.
+volatile double sink = 0;
+
+template <typename F>
+double measure_ns(long long evaluations, F &&evaluate_once) {
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    for (long long i = 0; i < evaluations; i++) {
+        evaluate_once();
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        clock::now() - start;
+    return elapsed.count() / static_cast<double>(evaluations);
+}
+
+#ifdef HAVE_POSIX
+long long to_kib(const rusage &usage) {
+#ifdef __APPLE__
+    return static_cast<long long>(usage.ru_maxrss) / 1024;  // In bytes.
+#else
+    return static_cast<long long>(usage.ru_maxrss);
+#endif
+}
+
+// Creates an empty temporary file which is not shared with other runs.
+std::optional<std::string> make_temp_file() {
+    std::string path =
+        (std::filesystem::temp_directory_path() / "calc-bench-XXXXXX")
+            .string();
+    const int fd = mkstemp(path.data());
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    close(fd);
+    return path;
+}
+#endif
+
+std::string long_sum(int terms) {
+    std::string s = "1";
+    for (int i = 1; i < terms; i++) {
+        s += "+sqrt(" + std::to_string(i) + ")";
+    }
+    return s;
+}
+
+// `std::mt19937_64` is specified exactly, unlike the standard distributions,
+// so the corpora are the same everywhere.
+class generator {
+public:
+    explicit generator(std::uint64_t seed) : random_(seed) {
+    }
+
+    int below(int n) {
+        return static_cast<int>(random_() % static_cast<std::uint64_t>(n));
+    }
+
+    std::string integer() {
+        return std::to_string(below(1000));
+    }
+
+    std::string decimal() {
+        std::string s = std::to_string(below(100'000));
+        s += '.';
+        for (int i = below(15); i >= 0; i--) {
+            s += static_cast<char>('0' + below(10));
+        }
+        if (below(2) == 0) {
+            s += (below(2) == 0 ? "e-" : "e") + std::to_string(below(300));
+        }
+        return s;
+    }
+
+    char binary_operator() {
+        return "+-*/"[below(4)];
+    }
+
+private:
+    std::mt19937_64 random_;
+};
+
+std::string flat_sum(generator &g) {
+    std::string s = g.integer();
+    for (int i = g.below(80) + 20; i > 0; i--) {
+        s += g.below(2) == 0 ? '+' : '-';
+        s += g.integer();
+    }
+    return s;
+}
+
+std::string deep_nesting(generator &g) {
+    const int depth = g.below(450) + 50;
+    std::string s(static_cast<std::size_t>(depth), '(');
+    s += g.integer();
+    for (int i = 0; i < depth; i++) {
+        s += g.binary_operator();
+        s += std::to_string(g.below(9) + 1);
+        s += ')';
+    }
+    return s;
+}
+
+std::string function_call(generator &g, int depth) {
+    if (depth == 0 || g.below(4) == 0) {
+        return g.integer();
+    }
+    if (g.below(4) == 0) {
+        return "pow(" + function_call(g, depth - 1) + "," +
+               std::to_string(g.below(3)) + ")";
+    }
+    static const char *const unary[] = {"sqrt", "sin", "cos"};
+    return std::string(unary[g.below(3)]) + "(" + function_call(g, depth - 1) +
+           ")";
+}
+
+std::string function_heavy(generator &g) {
+    std::string s = function_call(g, 6);
+    for (int i = g.below(8); i > 0; i--) {
+        s += g.binary_operator();
+        s += function_call(g, 6);
+    }
+    return s;
+}
+
+std::string number_heavy(generator &g) {
+    std::string s = g.decimal();
+    for (int i = g.below(10) + 5; i > 0; i--) {
+        s += g.binary_operator();
+        s += g.decimal();
+    }
+    return s;
+}
+
+// Valid expressions broken at a random place.
+std::string error_heavy(generator &g) {
+    const std::string s = g.below(2) == 0 ? flat_sum(g) : function_heavy(g);
+    const int length = static_cast<int>(s.size());
+    const auto at = static_cast<std::size_t>(g.below(length));
+    static const char *const insertions[] = {"#", "foo(", ")"};
+    const int kind = g.below(4);
+    if (kind == 3) {
+        return s.substr(0, at);
+    }
+    return s.substr(0, at) + insertions[kind] + s.substr(at);
+}
+
+struct corpus {
+    std::string name;
+    std::vector<std::string> lines;
+    std::size_t bytes = 0;  // Including newlines.
+};
+
+template <typename F>
+corpus
+make_corpus(std::string name, std::uint64_t seed, std::size_t size, F make) {
+    corpus c{std::move(name), {}, 0};
+    generator g(seed);
+    while (c.bytes < size) {
+        c.lines.push_back(make(g));
+        c.bytes += c.lines.back().size() + 1;
+    }
+    return c;
+}
+
+struct corpus_result {
+    std::string corpus;
+    std::string method;
+    std::size_t lines = 0;
+    std::size_t bytes = 0;
+    double seconds = 0;
+    std::optional<long long> peak_rss_kib;
+};
+
+double evaluate_seconds(const corpus &c) {
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    for (const std::string &line : c.lines) {
+        calc_result res;
+        calc_evaluate(line.c_str(), &res);
+        sink = res.value;
+    }
+    const std::chrono::duration<double> elapsed = clock::now() - start;
+    return elapsed.count();
+}
+
+// Evaluates in a child process where possible, so that the peak memory
+// belongs to this corpus and not to the earlier benchmarks.  It still
+// includes the memory of this process at the fork, mostly the corpus.
+corpus_result bench_evaluate(const corpus &c) {
+    corpus_result r{c.name, "evaluate", c.lines.size(), c.bytes, 0, {}};
+#ifdef HAVE_POSIX
+    int fds[2];
+    std::cout.flush();
+    if (pipe(fds) == 0) {
+        const pid_t child = fork();
+        if (child == 0) {
+            close(fds[0]);
+            const double seconds = evaluate_seconds(c);
+            const bool written =
+                write(fds[1], &seconds, sizeof seconds) == sizeof seconds;
+            _exit(written ? 0 : 1);
+        }
+        close(fds[1]);
+        double seconds = 0;
+        const bool read_all =
+            child > 0 && read(fds[0], &seconds, sizeof seconds) ==
+                             static_cast<ssize_t>(sizeof seconds);
+        close(fds[0]);
+        int status = 0;
+        rusage usage{};
+        if (child > 0 && wait4(child, &status, 0, &usage) == child &&
+            read_all && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            r.seconds = seconds;
+            r.peak_rss_kib = to_kib(usage);
+            return r;
+        }
+    }
+#endif
+    r.seconds = evaluate_seconds(c);
+    return r;
+}
+
+// Runs `calc-cli` on the corpus written to a temporary file.
+std::optional<corpus_result>
+bench_cli(const corpus &c, const std::string &cli) {
+#ifdef HAVE_POSIX
+    const std::optional<std::string> input = make_temp_file();
+    const std::optional<std::string> output = make_temp_file();
+    const auto remove_files = [&]() {
+        for (const std::optional<std::string> &path : {input, output}) {
+            if (path) {
+                std::filesystem::remove(*path);
+            }
+        }
+    };
+    bool written = false;
+    if (input && output) {
+        std::ofstream file(*input, std::ios::binary);
+        for (const std::string &line : c.lines) {
+            file << line << '\n';
+        }
+        written = static_cast<bool>(file.flush());
+    }
+    if (!written) {
+        remove_files();
+        return std::nullopt;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    const pid_t child = fork();
+    if (child == 0) {
+        execl(
+            cli.c_str(), cli.c_str(), input->c_str(), output->c_str(),
+            static_cast<char *>(nullptr)
+        );
+        _exit(127);
+    }
+    int status = 0;
+    rusage usage{};
+    const bool ran = child > 0 && wait4(child, &status, 0, &usage) == child;
+    const std::chrono::duration<double> elapsed = clock::now() - start;
+    remove_files();
+    if (!ran || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return std::nullopt;
+    }
+    return corpus_result{
+        c.name,  "cli",           c.lines.size(),
+        c.bytes, elapsed.count(), to_kib(usage),
+    };
+#else
+    (void)c;
+    (void)cli;
+    return std::nullopt;
+#endif
+}
+
+struct expression_result {
+    std::string expression;
+    double evaluate_ns = 0;
+    double prepared_ns = 0;
+    double compile_run_ns = 0;
+    double run_ns = 0;
+    double edit_ns = 0;
+};
+
+struct deep_result {
+    std::string shape;
+    int depth = 0;
+    double evaluate_ms = 0;
+    double compile_run_ms = 0;
+};
+
+struct columns_result {
+    std::string formula;
+    double switch_ns = 0;
+    double threaded_ns = 0;
+    double row_ns = 0;
+    double block_ns = 0;
+};
+
+std::string json_string(std::string_view s) {
+    std::string result = "\"";
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + '"';
+}
+
+std::string json_number(double value) {
+    std::array<char, 32> buffer{};
+    std::snprintf(buffer.data(), buffer.size(), "%.3f", value);
+    return buffer.data();
+}
+
+std::string json_optional(const std::optional<long long> &value) {
+    return value ? std::to_string(*value) : "null";
+}
+
+double ns_per_line(const corpus_result &r) {
+    return r.seconds * 1e9 / static_cast<double>(r.lines);
+}
+
+double megabytes_per_second(const corpus_result &r) {
+    return static_cast<double>(r.bytes) / r.seconds / 1e6;
+}
+
+struct results {
+    long long evaluations = 0;
+    std::size_t corpus_size = 0;
+    std::vector<expression_result> expressions;
+    std::vector<columns_result> columns;
+    std::vector<deep_result> deep;
+    std::vector<corpus_result> corpora;
+};
+
+void print_json(const results &all) {
+    std::cout << "{\n  \"evaluations\": " << all.evaluations
+              << ",\n  \"corpus_size\": " << all.corpus_size
+              << ",\n  \"expressions\": [";
+    const char *separator = "\n";
+    for (const expression_result &r : all.expressions) {
+        std::cout << separator << "    {\"expression\": "
+                  << json_string(r.expression)
+                  << ", \"evaluate_ns\": " << json_number(r.evaluate_ns)
+                  << ", \"prepared_ns\": " << json_number(r.prepared_ns)
+                  << ", \"compile_run_ns\": " << json_number(r.compile_run_ns)
+                  << ", \"run_ns\": " << json_number(r.run_ns)
+                  << ", \"edit_ns\": " << json_number(r.edit_ns) << "}";
+        separator = ",\n";
+    }
+    std::cout << "\n  ],\n  \"columns\": [";
+    separator = "\n";
+    for (const columns_result &r : all.columns) {
+        std::cout << separator << "    {\"formula\": " << json_string(r.formula)
+                  << ", \"switch_ns\": " << json_number(r.switch_ns)
+                  << ", \"threaded_ns\": " << json_number(r.threaded_ns)
+                  << ", \"row_ns\": " << json_number(r.row_ns)
+                  << ", \"block_ns\": " << json_number(r.block_ns) << "}";
+        separator = ",\n";
+    }
+    std::cout << "\n  ],\n  \"deep\": [";
+    separator = "\n";
+    for (const deep_result &r : all.deep) {
+        std::cout << separator << "    {\"shape\": " << json_string(r.shape)
+                  << ", \"depth\": " << r.depth
+                  << ", \"evaluate_ms\": " << json_number(r.evaluate_ms)
+                  << ", \"compile_run_ms\": " << json_number(r.compile_run_ms)
+                  << "}";
+        separator = ",\n";
+    }
+    std::cout << "\n  ],\n  \"corpora\": [";
+    separator = "\n";
+    for (const corpus_result &r : all.corpora) {
+        std::cout << separator << "    {\"corpus\": " << json_string(r.corpus)
+                  << ", \"method\": " << json_string(r.method)
+                  << ", \"lines\": " << r.lines << ", \"bytes\": " << r.bytes
+                  << ", \"ns_per_expression\": " << json_number(ns_per_line(r))
+                  << ", \"mb_per_s\": " << json_number(megabytes_per_second(r))
+                  << ", \"peak_rss_kib\": " << json_optional(r.peak_rss_kib)
+                  << "}";
+        separator = ",\n";
+    }
+    std::cout << "\n  ]\n}\n";
+}
+
+// Fits `name` into a column of the tables.
+std::string abbreviate(const std::string &name) {
+    return name.size() <= 20 ? name : name.substr(0, 17) + "...";
+}
+
+void print_tables(const results &all) {
+    std::cout << std::left << std::setw(24) << "expression" << std::right
+              << std::setw(14) << "evaluate" << std::setw(14) << "prepared"
+              << std::setw(14) << "compile+run" << std::setw(14) << "run"
+              << std::setw(14) << "edit" << "  (ns per evaluation, "
+              << all.evaluations << " evaluations)\n";
+    for (const expression_result &r : all.expressions) {
+        std::cout << std::left << std::setw(24) << abbreviate(r.expression)
+                  << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(14)
+                  << r.evaluate_ns << std::setw(14) << r.prepared_ns
+                  << std::setw(14) << r.compile_run_ns << std::setw(14)
+                  << r.run_ns << std::setw(14) << r.edit_ns << '\n';
+    }
+
+    std::cout << '\n'
+              << std::left << std::setw(24) << "columns" << std::right
+              << std::setw(14) << "switch" << std::setw(14) << "threaded"
+              << std::setw(14) << "row by row" << std::setw(14) << "blocks"
+              << "  (ns per row, " << all.evaluations << " rows)\n";
+    for (const columns_result &r : all.columns) {
+        std::cout << std::left << std::setw(24) << abbreviate(r.formula)
+                  << std::right
+                  << std::setw(14) << r.switch_ns << std::setw(14)
+                  << r.threaded_ns << std::setw(14) << r.row_ns
+                  << std::setw(14) << r.block_ns << '\n';
+    }
+
+    std::cout << '\n'
+              << std::left << std::setw(24) << "deep" << std::right
+              << std::setw(14) << "depth" << std::setw(14) << "evaluate"
+              << std::setw(14) << "compile+run" << "  (ms, once)\n";
+    for (const deep_result &r : all.deep) {
+        std::cout << std::left << std::setw(24) << r.shape << std::right
+                  << std::setw(14) << r.depth << std::setw(14)
+                  << r.evaluate_ms << std::setw(14) << r.compile_run_ms
+                  << '\n';
+    }
+
+    std::cout << '\n'
+              << std::left << std::setw(24) << "corpus" << std::setw(10)
+              << "method" << std::right << std::setw(10) << "lines"
+              << std::setw(14) << "ns/expr" << std::setw(10) << "MB/s"
+              << std::setw(14) << "peak KiB"
+              << "  (" << all.corpus_size << " bytes per corpus)\n";
+    for (const corpus_result &r : all.corpora) {
+        std::cout << std::left << std::setw(24) << r.corpus << std::setw(10)
+                  << r.method << std::right << std::setw(10) << r.lines
+                  << std::setw(14) << ns_per_line(r) << std::setw(10)
+                  << megabytes_per_second(r) << std::setw(14)
+                  << json_optional(r.peak_rss_kib) << '\n';
+    }
+}
+
+bool parse_count(const char *s, long long &count) {
+    char *end = nullptr;
+    count = std::strtoll(s, &end, 10);
+    return *s != '\0' && *end == '\0' && count > 0;
+}
+
+bool bench_expressions(results &all) {
+    const std::string expressions[] = {
+        "1+2*3",
+        "2*sqrt(16)-pow(2,3)/4",
+        "sin(0.5)*sin(0.5)+cos(0.5)*cos(0.5)-(1.5e3/(2+3))*pow(1.0001,10)",
+        long_sum(100),
+    };
+    calc_function_table *table = calc_functions_prepare(nullptr);
+    if (table == nullptr) {
+        std::cerr << "Unable to allocate function table\n";
+        return false;
+    }
+    for (const std::string &expr : expressions) {
+        calc_program *program = nullptr;
+        if (calc_compile(expr.c_str(), nullptr, &program, nullptr) != 0) {
+            std::cerr << "Unable to compile '" << expr << "'\n";
+            calc_functions_free(table);
+            return false;
+        }
+        expression_result r{expr};
+        r.evaluate_ns = measure_ns(all.evaluations, [&]() {
+            calc_result res;
+            calc_evaluate(expr.c_str(), &res);
+            sink = res.value;
+        });
+        r.prepared_ns = measure_ns(all.evaluations, [&]() {
+            calc_result res;
+            calc_evaluate_prepared(expr.c_str(), &res, table);
+            sink = res.value;
+        });
+        r.compile_run_ns = measure_ns(all.evaluations, [&]() {
+            calc_program *p = nullptr;
+            calc_compile(expr.c_str(), nullptr, &p, nullptr);
+            double value = 0;
+            calc_run(p, &value);
+            calc_free(p);
+            sink = value;
+        });
+        r.run_ns = measure_ns(all.evaluations, [&]() {
+            double value = 0;
+            calc_run(program, &value);
+            sink = value;
+        });
+        calc_free(program);
+
+        // Retyping the last digit, as a UI does while the user is typing.
+        calc_document *doc = calc_document_create(expr.c_str(), nullptr);
+        if (doc == nullptr) {
+            std::cerr << "Unable to allocate document\n";
+            calc_functions_free(table);
+            return false;
+        }
+        const std::size_t digit = expr.find_last_of("0123456789");
+        bool odd = false;
+        r.edit_ns = measure_ns(all.evaluations, [&]() {
+            calc_result res;
+            calc_document_edit(doc, digit, 1, odd ? "1" : "2", &res);
+            odd = !odd;
+            sink = res.value;
+        });
+        calc_document_free(doc);
+        all.expressions.push_back(r);
+    }
+    calc_functions_free(table);
+    return true;
+}
+
+// The same number of rows evaluated one by one with both backends of
+// `calc_run_variables`, one by one with `calc_eval_columns` and in blocks.
+bool bench_columns(results &all) {
+    const std::string formulas[] = {
+        "x*2+y",
+        "(x*0.5+1)*(y*2-3)+x/y-7",
+        "pow(x,2)+sin(y)*pow(x,2)-sin(y)/pow(x,2)",
+        "(x-y)*(x+y)/(1+x*x)",
+        "sqrt(x*x+y*y)",
+    };
+    const char *const variables[] = {"x", "y", nullptr};
+    const auto rows = static_cast<std::size_t>(all.evaluations);
+    std::vector<double> x(rows);
+    std::vector<double> y(rows);
+    std::vector<double> out(rows);
+    for (std::size_t row = 0; row < rows; row++) {
+        x[row] = static_cast<double>(row % 1000) * 0.25;
+        y[row] = static_cast<double>(row % 77) - 30;
+    }
+    const double *const inputs[] = {x.data(), y.data()};
+    for (const std::string &formula : formulas) {
+        calc_program *program = nullptr;
+        if (calc_compile_columns(
+                formula.c_str(), nullptr, variables, &program, nullptr
+            ) != 0) {
+            std::cerr << "Unable to compile '" << formula << "'\n";
+            return false;
+        }
+        columns_result r{formula};
+        const auto run_rows = [&](calc_backend backend) {
+            calc_set_backend(program, backend);
+            std::size_t row = 0;
+            return measure_ns(all.evaluations, [&]() {
+                const double values[] = {x[row], y[row]};
+                calc_run_variables(program, values, &out[row]);
+                row++;
+            });
+        };
+        r.switch_ns = run_rows(CALC_BACKEND_SWITCH);
+        r.threaded_ns = run_rows(CALC_BACKEND_THREADED);
+        std::size_t row = 0;
+        r.row_ns = measure_ns(all.evaluations, [&]() {
+            const double *const row_inputs[] = {&x[row], &y[row]};
+            calc_eval_columns(program, 1, row_inputs, &out[row]);
+            row++;
+        });
+        r.block_ns = measure_ns(1, [&]() {
+            calc_eval_columns(program, rows, inputs, out.data());
+        }) / static_cast<double>(rows);
+        sink = out[rows - 1];
+        calc_free(program);
+        all.columns.push_back(r);
+    }
+    return true;
+}
+
+// Nesting far deeper than `calc_test` can afford, once per shape.
+bool bench_deep(results &all) {
+    const int depth = 10'000'000;
+    std::string parentheses(depth, '(');
+    parentheses += "1234";
+    parentheses.append(depth, ')');
+    std::string calls;
+    for (int i = 0; i < depth / 10; i++) {
+        calls += "1+sqrt(";
+    }
+    calls += "0";
+    calls.append(depth / 10, ')');
+    const std::pair<std::string, const std::string &> shapes[] = {
+        {"parentheses", parentheses},
+        {"operators and calls", calls},
+    };
+    for (const auto &[shape, expr] : shapes) {
+        deep_result r{shape, shape == "parentheses" ? depth : depth / 10};
+        bool ok = true;
+        r.evaluate_ms = measure_ns(1, [&]() {
+            calc_result res;
+            ok = calc_evaluate(expr.c_str(), &res) == 0;
+            sink = res.value;
+        }) / 1e6;
+        r.compile_run_ms = measure_ns(1, [&]() {
+            calc_program *p = nullptr;
+            if (calc_compile(expr.c_str(), nullptr, &p, nullptr) != 0) {
+                ok = false;
+                return;
+            }
+            double value = 0;
+            calc_run(p, &value);
+            calc_free(p);
+            sink = value;
+        }) / 1e6;
+        if (!ok) {
+            std::cerr << "Unable to evaluate " << shape << " of depth "
+                      << r.depth << "\n";
+            return false;
+        }
+        all.deep.push_back(r);
+    }
+    return true;
+}
+
+void bench_corpora(results &all, const std::string &cli) {
+    const std::size_t size = all.corpus_size;
+    const corpus corpora[] = {
+        make_corpus("flat-sums", 1, size, flat_sum),
+        make_corpus("deep-nesting", 2, size, deep_nesting),
+        make_corpus("function-heavy", 3, size, function_heavy),
+        make_corpus("number-heavy", 4, size, number_heavy),
+        make_corpus("error-heavy", 5, size, error_heavy),
+    };
+    bool run_cli = true;
+    for (const corpus &c : corpora) {
+        all.corpora.push_back(bench_evaluate(c));
+        if (!run_cli) {
+            continue;
+        }
+        std::optional<corpus_result> r = bench_cli(c, cli);
+        if (r) {
+            all.corpora.push_back(*r);
+        } else {
+            std::cerr << "Unable to run '" << cli
+                      << "', skipping the CLI path\n";
+            run_cli = false;
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    results all;
+    all.evaluations = 1'000'000;
+    long long corpus_size = 2'000'000;
+    bool json = false;
+    std::string cli =
+        (std::filesystem::path(argv[0]).parent_path() / "calc-cli").string();
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        bool ok = true;
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--evaluations" && i + 1 < argc) {
+            ok = parse_count(argv[++i], all.evaluations);
+        } else if (arg == "--corpus-size" && i + 1 < argc) {
+            ok = parse_count(argv[++i], corpus_size);
+        } else if (arg == "--cli" && i + 1 < argc) {
+            cli = argv[++i];
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--json] [--evaluations N] [--corpus-size BYTES]"
+                         " [--cli PATH]\n";
+            return 1;
+        }
+    }
+    all.corpus_size = static_cast<std::size_t>(corpus_size);
+
+    if (!bench_expressions(all) || !bench_columns(all) || !bench_deep(all)) {
+        return 1;
+    }
+    bench_corpora(all, cli);
+    if (json) {
+        print_json(all);
+    } else {
+        print_tables(all);
+    }
+}
@@ -1,8 +1,450 @@
 #ifdef _MSC_VER
 #include <crtdbg.h>
 #endif
+#include <math.h>
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "calc.h"
+
+enum {
+    INPUT_CHUNK_SIZE = 1 << 20,
+    // Smaller so that even moderate files keep all threads busy.
+    PARALLEL_INPUT_CHUNK_SIZE = 1 << 18,
+    MAX_THREADS = 1024,
+    OUTPUT_BUFFER_SIZE = 1 << 20,
+    // Used when the large buffers cannot be allocated.
+    FALLBACK_BUFFER_SIZE = 4096,
+    // Enough for any `%.3f\n` of a double.
+    MAX_VALUE_LENGTH = 400,
+};
+
+// The input is read in large chunks, and every complete line is parsed right
+// in the chunk.  Only the incomplete line at its end is moved to the
+// beginning before reading the next chunk.
+typedef struct input {
+    FILE *file;
+    char *data;
+    size_t size;  // Length of the incomplete line at the beginning of `data`.
+    size_t capacity;  // Not counting a byte for the terminating '\0'.
+    char *fallback_data;
+} input;
+
+// Results are formatted into a large buffer which is written at once.  An
+// output without a file keeps everything in memory, growing the buffer.
+typedef struct output {
+    FILE *file;
+    char *data;
+    size_t size;
+    size_t capacity;
+    bool failed;  // Set when a buffer in memory cannot grow.
+} output;
+
+static void output_flush(output *out) {
+    fwrite(out->data, 1, out->size, out->file);
+    out->size = 0;
+}
+
+// Returns false if there is still no room for `size` bytes.
+static bool output_make_room(output *out, size_t size) {
+    if (out->capacity - out->size >= size) {
+        return true;
+    }
+    if (out->file != NULL) {
+        output_flush(out);
+        return out->capacity >= size;
+    }
+    size_t new_capacity = out->capacity == 0 ? 65536 : out->capacity;
+    while (!out->failed && new_capacity - out->size < size) {
+        out->failed = new_capacity > SIZE_MAX / 2;
+        new_capacity *= 2;
+    }
+    char *new_data = out->failed ? NULL : realloc(out->data, new_capacity);
+    if (new_data == NULL) {
+        out->failed = true;
+        return false;
+    }
+    out->data = new_data;
+    out->capacity = new_capacity;
+    return true;
+}
 
-int main(void) {
+static void output_write(output *out, const char *data, size_t size) {
+    if (output_make_room(out, size)) {
+        memcpy(out->data + out->size, data, size);
+        out->size += size;
+    } else if (out->file != NULL) {
+        fwrite(data, 1, size, out->file);
+    }
+}
+
+// Returns a place for at most `size` bytes, or null if there is none.  `size`
+// must be less than the capacity of an output to a file.
+static char *output_reserve(output *out, size_t size) {
+    return output_make_room(out, size) ? out->data + out->size : NULL;
+}
+
+// Same as `fprintf(out, "%.3f\n", value)`.
+static void print_value(output *out, double value) {
+    char *buf = output_reserve(out, MAX_VALUE_LENGTH);
+    if (buf == NULL) {
+        return;
+    }
+    double scaled = fabs(value) * 1000;
+    // The product may differ from the exact `value * 1000` by less than 2^-12
+    // below 2^40, so rounding it gives the same digits unless it is close to
+    // a tie, where `printf` is left to round the exact value.
+    if (scaled < 0x1p40 && fabs(scaled - floor(scaled) - 0.5) > 1e-3) {
+        uint64_t rounded = (uint64_t)floor(scaled + 0.5);
+        char digits[24];
+        size_t length = 0;
+        for (int i = 0; i < 4 || rounded > 0; i++) {
+            if (i == 3) {
+                digits[length++] = '.';
+            }
+            digits[length++] = (char)('0' + rounded % 10);
+            rounded /= 10;
+        }
+        size_t size = 0;
+        if (signbit(value)) {
+            buf[size++] = '-';
+        }
+        while (length > 0) {
+            buf[size++] = digits[--length];
+        }
+        buf[size++] = '\n';
+        out->size += size;
+        return;
+    }
+    int size = snprintf(buf, MAX_VALUE_LENGTH, "%.3f\n", value);
+    if (size > 0) {
+        out->size += (size_t)size;
+    }
+}
+
+static void print_dots(output *out, int count) {
+    static const char dots[] = "................................";
+    const int chunk = (int)sizeof(dots) - 1;
+    for (; count > chunk; count -= chunk) {
+        output_write(out, dots, (size_t)chunk);
+    }
+    output_write(out, dots, (size_t)count);
+}
+
+static void print_result(output *out, const char *expr, size_t length) {
+    calc_result res;
+    calc_error error = calc_evaluate(expr, &res, NULL);
+    if (error == CALC_ERROR_OK) {
+        print_value(out, res.value);
+        return;
+    }
+    if (error == CALC_ERROR_OUT_OF_MEMORY) {
+        fprintf(stderr, "Unable to allocate buffer\n");
+        print_value(out, 0);
+        return;
+    }
+    char *header = output_reserve(out, MAX_VALUE_LENGTH);
+    if (header == NULL) {
+        return;
+    }
+    out->size += (size_t)sprintf(header, "Error %d:\n  ", (int)error);
+    output_write(out, expr, length);
+    output_write(out, "\n  ", 3);
+    print_dots(out, res.error_position);
+    output_write(out, "^\n", 2);
+}
+
+// Evaluates every complete line in `[begin, end)`, replacing its '\n' with
+// '\0', and returns the beginning of the incomplete line.
+static char *print_lines(output *out, char *begin, char *end) {
+    for (;;) {
+        char *newline = memchr(begin, '\n', (size_t)(end - begin));
+        if (newline == NULL) {
+            return begin;
+        }
+        *newline = '\0';
+        print_result(out, begin, (size_t)(newline - begin));
+        begin = newline + 1;
+    }
+}
+
+static bool input_grow(input *in) {
+    if (in->capacity > SIZE_MAX / 2 - 1) {
+        return false;
+    }
+    size_t new_capacity = in->capacity * 2;
+    char *new_data = NULL;
+    if (in->data == in->fallback_data) {
+        new_data = malloc(new_capacity + 1);
+        if (new_data != NULL) {
+            memcpy(new_data, in->data, in->size);
+        }
+    } else {
+        new_data = realloc(in->data, new_capacity + 1);
+    }
+    if (new_data == NULL) {
+        return false;
+    }
+    in->data = new_data;
+    in->capacity = new_capacity;
+    return true;
+}
+
+// Drops the rest of the line that does not fit in memory.
+static bool skip_line(input *in) {
+    for (;;) {
+        size_t read = fread(in->data, 1, in->capacity, in->file);
+        in->size = 0;
+        if (read == 0) {
+            return !ferror(in->file);
+        }
+        char *newline = memchr(in->data, '\n', read);
+        if (newline != NULL) {
+            in->size = read - (size_t)(newline + 1 - in->data);
+            memmove(in->data, newline + 1, in->size);
+            return true;
+        }
+    }
+}
+
+static char *after_last_newline(char *begin, char *end) {
+    while (end != begin && end[-1] != '\n') {
+        end--;
+    }
+    return end;
+}
+
+#ifdef HAVE_PTHREADS
+// A chunk of complete lines and their results.
+typedef struct job {
+    char *data;
+    size_t size;
+    size_t capacity;
+    output out;  // In memory.
+    char *resume;  // The first line left for the writer if `out` failed.
+    bool done;
+} job;
+
+// Chunks are evaluated by worker threads and written by the main thread in
+// the input order.  At most `jobs_count` chunks are in flight, so memory is
+// bounded regardless of the input size.
+typedef struct pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t job_submitted;
+    pthread_cond_t job_done;
+    pthread_t *threads;
+    size_t threads_count;
+    job *jobs;  // A ring buffer indexed by the counters below.
+    size_t jobs_count;
+    size_t submitted;
+    size_t taken;
+    size_t written;  // Only used by the main thread.
+    bool stopping;
+} pool;
+
+static void run_job(job *j) {
+    j->out.size = 0;
+    j->out.failed = false;
+    j->resume = NULL;
+    char *begin = j->data;
+    char *end = j->data + j->size;
+    while (begin != end) {
+        char *newline = memchr(begin, '\n', (size_t)(end - begin));
+        *newline = '\0';
+        size_t size_before = j->out.size;
+        print_result(&j->out, begin, (size_t)(newline - begin));
+        if (j->out.failed) {
+            *newline = '\n';
+            j->out.size = size_before;
+            j->resume = begin;
+            return;
+        }
+        begin = newline + 1;
+    }
+}
+
+static void *worker(void *arg) {
+    pool *p = arg;
+    pthread_mutex_lock(&p->mutex);
+    for (;;) {
+        while (!p->stopping && p->taken == p->submitted) {
+            pthread_cond_wait(&p->job_submitted, &p->mutex);
+        }
+        if (p->taken == p->submitted) {
+            break;
+        }
+        job *j = &p->jobs[p->taken++ % p->jobs_count];
+        pthread_mutex_unlock(&p->mutex);
+        run_job(j);
+        pthread_mutex_lock(&p->mutex);
+        j->done = true;
+        pthread_cond_signal(&p->job_done);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+static void pool_destroy(pool *p) {
+    pthread_mutex_lock(&p->mutex);
+    p->stopping = true;
+    pthread_cond_broadcast(&p->job_submitted);
+    pthread_mutex_unlock(&p->mutex);
+    for (size_t i = 0; i < p->threads_count; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+    pthread_cond_destroy(&p->job_done);
+    pthread_cond_destroy(&p->job_submitted);
+    pthread_mutex_destroy(&p->mutex);
+    for (size_t i = 0; i < p->jobs_count; i++) {
+        free(p->jobs[i].data);
+        free(p->jobs[i].out.data);
+    }
+    free(p->jobs);
+    free(p->threads);
+}
+
+// Returns false if not a single thread can be started.
+static bool pool_init(pool *p, size_t threads_count) {
+    p->threads_count = 0;
+    p->jobs_count = 2 * threads_count;
+    p->submitted = p->taken = p->written = 0;
+    p->stopping = false;
+    p->threads = calloc(threads_count, sizeof(pthread_t));
+    p->jobs = calloc(p->jobs_count, sizeof(job));
+    if (p->threads == NULL || p->jobs == NULL) {
+        free(p->threads);
+        free(p->jobs);
+        return false;
+    }
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->job_submitted, NULL);
+    pthread_cond_init(&p->job_done, NULL);
+    for (; p->threads_count < threads_count; p->threads_count++) {
+        if (pthread_create(&p->threads[p->threads_count], NULL, worker, p) !=
+            0) {
+            break;
+        }
+    }
+    if (p->threads_count == 0) {
+        pool_destroy(p);
+        return false;
+    }
+    return true;
+}
+
+static void write_oldest(pool *p, output *out) {
+    job *j = &p->jobs[p->written % p->jobs_count];
+    pthread_mutex_lock(&p->mutex);
+    while (!j->done) {
+        pthread_cond_wait(&p->job_done, &p->mutex);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    output_write(out, j->out.data, j->out.size);
+    if (j->resume != NULL) {
+        print_lines(out, j->resume, j->data + j->size);
+    }
+    p->written++;
+}
+
+static void pool_drain(pool *p, output *out) {
+    while (p->written != p->submitted) {
+        write_oldest(p, out);
+    }
+}
+
+// Queues complete lines in `[begin, end)`, waiting for a free job if needed.
+static void pool_submit(pool *p, output *out, char *begin, char *end) {
+    if (p->submitted - p->written == p->jobs_count) {
+        write_oldest(p, out);
+    }
+    job *j = &p->jobs[p->submitted % p->jobs_count];
+    size_t size = (size_t)(end - begin);
+    if (j->capacity < size) {
+        char *new_data = realloc(j->data, size);
+        if (new_data == NULL) {
+            // Evaluate right here, but after all previous lines.
+            pool_drain(p, out);
+            print_lines(out, begin, end);
+            return;
+        }
+        j->data = new_data;
+        j->capacity = size;
+    }
+    memcpy(j->data, begin, size);
+    j->size = size;
+    pthread_mutex_lock(&p->mutex);
+    j->done = false;
+    p->submitted++;
+    pthread_cond_signal(&p->job_submitted);
+    pthread_mutex_unlock(&p->mutex);
+}
+#else
+// Threads are not supported, so there are no pools and lines are evaluated
+// by the main thread.
+typedef struct pool pool;
+
+static void pool_drain(pool *p, output *out) {
+    (void)p;
+    (void)out;
+}
+
+static void pool_submit(pool *p, output *out, char *begin, char *end) {
+    (void)p;
+    print_lines(out, begin, end);
+}
+#endif
+
+// Evaluates lines on `p` if it is not null.  Returns false on a read error.
+static bool print_input(output *out, input *in, pool *p) {
+    for (;;) {
+        if (in->size == in->capacity && !input_grow(in)) {
+            if (p != NULL) {
+                pool_drain(p, out);
+            }
+            fprintf(stderr, "Unable to allocate buffer\n");
+            print_value(out, 0);
+            if (!skip_line(in)) {
+                return false;
+            }
+            continue;
+        }
+        size_t read = fread(
+            in->data + in->size, 1, in->capacity - in->size, in->file
+        );
+        if (read == 0) {
+            if (p != NULL) {
+                pool_drain(p, out);
+            }
+            if (ferror(in->file)) {
+                return false;
+            }
+            if (in->size > 0) {  // The last line without '\n'.
+                in->data[in->size] = '\0';
+                print_result(out, in->data, in->size);
+            }
+            return true;
+        }
+        char *end = in->data + in->size + read;
+        char *incomplete = NULL;
+        if (p != NULL) {
+            incomplete = after_last_newline(in->data, end);
+            if (incomplete != in->data) {
+                pool_submit(p, out, in->data, incomplete);
+            }
+        } else {
+            incomplete = print_lines(out, in->data, end);
+        }
+        in->size = (size_t)(end - incomplete);
+        memmove(in->data, incomplete, in->size);
+    }
+}
+
+int main(int argc, char *argv[]) {
 #ifdef _MSC_VER
     _CrtSetReportMode(_CRT_ASSERT, _CRTDBG_MODE_FILE | _CRTDBG_MODE_DEBUG);
     _CrtSetReportFile(_CRT_ASSERT, _CRTDBG_FILE_STDERR);
@@ -10,5 +452,94 @@ int main(void) {
     _CrtSetReportFile(_CRT_ERROR, _CRTDBG_FILE_STDERR);
 #endif
 
-    // TODO
+    // `calc-cli -j <threads> <input> <output>` evaluates lines in parallel
+    // with up to `MAX_THREADS` threads.  The usage message leaves the option
+    // out because its format is fixed.
+    long threads_count = 1;
+    char **files = argv + 1;
+    if (argc == 5 && strcmp(argv[1], "-j") == 0) {
+        char *end = NULL;
+        threads_count = strtol(argv[2], &end, 10);
+        if (*end != '\0' || threads_count < 1 ||
+            threads_count > MAX_THREADS) {
+            threads_count = 0;
+        }
+        files += 2;
+    } else if (argc != 3) {
+        threads_count = 0;
+    }
+    if (threads_count == 0) {
+        fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+        return 1;
+    }
+
+    int exit_code = 1;
+    FILE *in_file = fopen(files[0], "r");
+    if (in_file == NULL) {
+        fprintf(stderr, "Unable to open '%s' for reading\n", files[0]);
+        goto exit;
+    }
+    FILE *out_file = fopen(files[1], "w");
+    if (out_file == NULL) {
+        fprintf(stderr, "Unable to open '%s' for writing\n", files[1]);
+        goto close_in;
+    }
+
+    static char fallback_input[FALLBACK_BUFFER_SIZE + 1];
+    static char fallback_output[FALLBACK_BUFFER_SIZE];
+    input in = {
+        .file = in_file,
+        .data = malloc(INPUT_CHUNK_SIZE + 1),
+        .capacity = INPUT_CHUNK_SIZE,
+        .fallback_data = fallback_input,
+    };
+    if (in.data == NULL) {
+        in.data = fallback_input;
+        in.capacity = FALLBACK_BUFFER_SIZE;
+    }
+    output out = {
+        .file = out_file,
+        .data = malloc(OUTPUT_BUFFER_SIZE),
+        .capacity = OUTPUT_BUFFER_SIZE,
+    };
+    if (out.data == NULL) {
+        out.data = fallback_output;
+        out.capacity = FALLBACK_BUFFER_SIZE;
+    }
+
+    pool *p = NULL;
+#ifdef HAVE_PTHREADS
+    pool threads;
+    if (threads_count > 1 && pool_init(&threads, (size_t)threads_count)) {
+        p = &threads;
+        if (in.capacity > PARALLEL_INPUT_CHUNK_SIZE) {
+            in.capacity = PARALLEL_INPUT_CHUNK_SIZE;
+        }
+    }
+#endif
+
+    if (print_input(&out, &in, p)) {
+        exit_code = 0;
+    } else {
+        fprintf(stderr, "Error while reading from the input\n");
+    }
+    output_flush(&out);
+
+#ifdef HAVE_PTHREADS
+    if (p != NULL) {
+        pool_destroy(p);
+    }
+#endif
+
+    if (in.data != fallback_input) {
+        free(in.data);
+    }
+    if (out.data != fallback_output) {
+        free(out.data);
+    }
+    fclose(out_file);
+close_in:
+    fclose(in_file);
+exit:
+    return exit_code;
 }
@@ -1,6 +1,17 @@
 #include "calc.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
 #include <limits>
+#include <random>
 #include <string>
+#include <vector>
 #include "doctest.h"
 #include "tests_config.h"
 
@@ -186,6 +197,44 @@ TEST_CASE("Call with custom functions") {
         CHECK_POS(res.error_position, 5);
     }
 }
+
+TEST_CASE("Prepared function table") {
+    SUBCASE("Standard functions") {
+        calc_function_table *table = calc_functions_prepare(nullptr);
+        REQUIRE(table != nullptr);
+        calc_result res;
+        REQUIRE(calc_evaluate_prepared("sqrt(16)+pow(2,3)", &res, table) == 0);
+        CHECK(res.value == doctest::Approx(12));
+        REQUIRE_ERR(
+            calc_evaluate_prepared("sq(16)", &res, table),
+            CALC_ERROR_UNKNOWN_FUNCTION
+        );
+        CHECK_POS(res.error_position, 2);
+        calc_functions_free(table);
+    }
+    SUBCASE("Names are copied and prefixes do not match") {
+        std::string names[] = {"f", "ff", "fff"};
+        calc_function funcs[] = {
+            {names[0].c_str(), 0, {.func0 = []() { return 1.0; }}},
+            {names[1].c_str(), 1, {.func1 = [](double x) { return x * 2; }}},
+            {names[2].c_str(), 1, {.func1 = [](double x) { return x * 3; }}},
+            CALC_FUNCTIONS_SENTINEL,
+        };
+        calc_function_table *table = calc_functions_prepare(funcs);
+        REQUIRE(table != nullptr);
+        for (std::string &name : names) {
+            name[0] = 'g';
+        }
+        calc_result res;
+        REQUIRE(calc_evaluate_prepared("fff(ff(f()))", &res, table) == 0);
+        CHECK(res.value == doctest::Approx(6));
+        REQUIRE_ERR(
+            calc_evaluate_prepared("ffff(1)", &res, table),
+            CALC_ERROR_UNKNOWN_FUNCTION
+        );
+        calc_functions_free(table);
+    }
+}
 #endif  // TEST_FUNCTIONS
 
 #ifdef TEST_COMPLEX_EXPRESSIONS
@@ -250,11 +299,639 @@ TEST_CASE("Deep expression") {
     CHECK(res.value == doctest::Approx(1234));
 }
 
+// `calc-bench` evaluates 10'000'000 levels, too slow under Valgrind here.
+TEST_CASE("Very deep expression") {
+    SUBCASE("Parentheses") {
+        const int DEPTH = 100'000;
+        std::string s;
+        s.append(DEPTH, '(');
+        s.append("1234");
+        s.append(DEPTH, ')');
+
+        calc_result res;
+        REQUIRE(calc_evaluate(s.c_str(), &res) == 0);
+        CHECK(res.value == doctest::Approx(1234));
+
+        s.pop_back();
+        REQUIRE_ERR(
+            calc_evaluate(s.c_str(), &res), CALC_ERROR_EXPECTED_CLOSE_PAREN
+        );
+        CHECK_POS(res.error_position, 2 * DEPTH + 3);
+    }
+    SUBCASE("Right-nested operators and calls") {
+        const int DEPTH = 100'000;
+        std::string s;
+        for (int i = 0; i < DEPTH; i++) {
+            s += "1+sqrt(";
+        }
+        s += "0";
+        s.append(DEPTH, ')');
+
+        calc_result res;
+        REQUIRE(calc_evaluate(s.c_str(), &res) == 0);
+        CHECK(res.value == doctest::Approx(2.6180339887));
+
+        calc_program *program = nullptr;
+        REQUIRE(calc_compile(s.c_str(), nullptr, &program, nullptr) == 0);
+        double value = 0;
+        calc_run(program, &value);
+        CHECK(value == res.value);
+        calc_free(program);
+    }
+}
+
 TEST_CASE("Floating-point numbers") {
     calc_result res;
     REQUIRE(calc_evaluate("1.2+3.4*0.1", &res) == 0);
     CHECK(res.value == doctest::Approx(1.54));
 }
+
+namespace {
+// Checks that `token` in parentheses is parsed exactly like `strtod` does.
+void check_number_like_strtod(const std::string &token) {
+    CAPTURE(token);
+    char *end = nullptr;
+    const double expected = std::strtod(token.c_str(), &end);
+    const auto length = static_cast<int>(end - token.c_str());
+    calc_result res;
+    const calc_error error = calc_evaluate(("(" + token + ")").c_str(), &res);
+    if (length == 0) {
+        REQUIRE(error == CALC_ERROR_BAD_NUMBER);
+        CHECK(res.error_position == 1);
+    } else if (length != static_cast<int>(token.size())) {
+        REQUIRE(error == CALC_ERROR_EXPECTED_CLOSE_PAREN);
+        CHECK(res.error_position == 1 + length);
+    } else if (std::isnan(expected)) {
+        REQUIRE(error == 0);
+        CHECK(std::isnan(res.value));
+        CHECK(std::signbit(res.value) == std::signbit(expected));
+    } else {
+        REQUIRE(error == 0);
+        CHECK(std::memcmp(&res.value, &expected, sizeof(expected)) == 0);
+    }
+}
+}  // namespace
+
+TEST_CASE("Numbers are parsed like strtod") {
+    SUBCASE("Special cases") {
+        for (const char *token :
+             {"0", "-0", "+.5", "5.", ".", "-.", "1e", "1e+", "1E-2", "1e5x",
+              "0x", "0x.", "0x1p", "0X1.8P-3", "0x1.fffffffffffff8p1023",
+              "0x1p-1075", "0x1.00000000000008p0", "1e400", "1e-400",
+              "4.9406564584124654e-324", "2.4703282292062328e-324",
+              "2.4703282292062327e-324", "1.7976931348623158e308",
+              "1.7976931348623159e308", "9007199254740993",
+              "9007199254740993.0000000000000000000000000000001",
+              // Without a sign these are function names.
+              "+inf", "-Infinity", "+infin", "-nan", "+NaN(1_a)",
+              "+nan(-)", "-in", "+n"}) {
+            check_number_like_strtod(token);
+        }
+    }
+    SUBCASE("Random numbers") {
+        std::mt19937_64 random(2024);
+        const auto below = [&](int n) {
+            return static_cast<int>(random() % n);
+        };
+        const auto digits = [&](int count) {
+            std::string result;
+            for (int i = 0; i < count; i++) {
+                result += static_cast<char>('0' + below(10));
+            }
+            return result;
+        };
+        for (int i = 0; i < 20'000; i++) {
+            // A sign keeps `inf` and `nan` from being function names.
+            std::string token = below(2) == 0 ? "-" : "+";
+            std::array<char, 1000> buffer{};
+            double value = 0;
+            const std::uint64_t bits = random();
+            std::memcpy(&value, &bits, sizeof(value));
+            value = std::fabs(value);
+            switch (below(5)) {
+                case 0:
+                    std::snprintf(buffer.data(), buffer.size(), "%.17g", value);
+                    token += buffer.data();
+                    break;
+                case 1:
+                    std::snprintf(buffer.data(), buffer.size(), "%a", value);
+                    token += buffer.data();
+                    break;
+                case 2:
+                    // Exactly between two adjacent doubles.
+                    if (std::numeric_limits<long double>::digits >= 64 &&
+                        std::isfinite(value)) {
+                        const long double middle =
+                            (static_cast<long double>(value) +
+                             std::nextafter(value, HUGE_VAL)) /
+                            2;
+                        std::snprintf(
+                            buffer.data(), buffer.size(), "%.780Le", middle
+                        );
+                        token += buffer.data();
+                    }
+                    break;
+                case 3:
+                    token += digits(below(40)) + "." + digits(below(40)) +
+                             "e" + std::to_string(below(700) - 350);
+                    break;
+                default:
+                    token += "0." + std::string(below(400), '0') +
+                             digits(1 + below(30)) + "e" +
+                             std::to_string(below(100));
+                    break;
+            }
+            check_number_like_strtod(token);
+        }
+    }
+}
+
+TEST_CASE("Compiled program") {
+    SUBCASE("Same results as evaluate") {
+        for (const char *expr :
+             {"1+2*3", " 7 ", "(1-2)-(3-4)", "2*sqrt(16)-pow(2,3)/4",
+              "1/3+sin(1)*cos(2/3)", "pow(pow(2,2),(1+1))"}) {
+            CAPTURE(expr);
+            calc_result expected;
+            REQUIRE(calc_evaluate(expr, &expected) == 0);
+            calc_program *program = nullptr;
+            REQUIRE(calc_compile(expr, nullptr, &program, nullptr) == 0);
+            REQUIRE(program != nullptr);
+            for (int run = 0; run < 2; run++) {
+                double value = 0;
+                calc_run(program, &value);
+                CHECK(value == expected.value);
+            }
+            calc_free(program);
+        }
+    }
+    SUBCASE("Same error positions as evaluate") {
+        for (const char *expr :
+             {"", "1+", "  sqrt 2", "pow(1 2)", "((1)", "1 2", "2*abc(1)",
+              "1+#", "sin(1,2)", "pow(1,)"}) {
+            CAPTURE(expr);
+            calc_result expected;
+            const calc_error error = calc_evaluate(expr, &expected);
+            REQUIRE(error != 0);
+            calc_program *program = nullptr;
+            int position = -1;
+            CHECK(calc_compile(expr, nullptr, &program, &position) == error);
+            CHECK(program == nullptr);
+            CHECK(position == expected.error_position);
+        }
+    }
+    SUBCASE("Functions are called on every run") {
+        static int calls = 0;
+        calc_function funcs[] = {
+            {"next", 0, {.func0 = []() { return double(++calls); }}},
+            CALC_FUNCTIONS_SENTINEL,
+        };
+        calc_program *program = nullptr;
+        REQUIRE(
+            calc_compile("next()*10+next()", funcs, &program, nullptr) == 0
+        );
+        CHECK(calls == 0);
+        double value = 0;
+        calc_run(program, &value);
+        CHECK(value == 12);
+        calc_run(program, &value);
+        CHECK(value == 34);
+        calc_free(program);
+    }
+}
+
+TEST_CASE("Columns") {
+    const char *const variables[] = {"x", "y", "sin", nullptr};
+    SUBCASE("Variables are bound to columns") {
+        calc_program *program = nullptr;
+        REQUIRE(
+            calc_compile_columns(
+                "x*2-sqrt(y)/(sin+1)+pow(x,cos(y))", nullptr, variables,
+                &program, nullptr
+            ) == 0
+        );
+        // Not a multiple of a block size to check the last partial block.
+        const int rows = 1'000;
+        std::vector<double> x(rows);
+        std::vector<double> y(rows);
+        std::vector<double> z(rows);
+        for (int row = 0; row < rows; row++) {
+            x[row] = row * 0.5;
+            y[row] = row % 7;
+            z[row] = -row;
+        }
+        const double *const inputs[] = {x.data(), y.data(), z.data()};
+        std::vector<double> out(rows);
+        calc_eval_columns(program, rows, inputs, out.data());
+        for (int row = 0; row < rows; row++) {
+            CAPTURE(row);
+            CHECK(
+                out[row] == x[row] * 2 - std::sqrt(y[row]) / (z[row] + 1) +
+                                std::pow(x[row], std::cos(y[row]))
+            );
+        }
+        calc_free(program);
+    }
+    SUBCASE("Constants and calls without arguments") {
+        static int calls = 0;
+        calc_function funcs[] = {
+            {"next", 0, {.func0 = []() { return double(++calls); }}},
+            CALC_FUNCTIONS_SENTINEL,
+        };
+        calc_program *program = nullptr;
+        REQUIRE(
+            calc_compile_columns(
+                "next()*(2+3)", funcs, nullptr, &program, nullptr
+            ) == 0
+        );
+        std::vector<double> out(600);
+        calc_eval_columns(program, out.size(), nullptr, out.data());
+        for (std::size_t row = 0; row < out.size(); row++) {
+            CHECK(out[row] == static_cast<double>(row + 1) * 5);
+        }
+        calc_free(program);
+    }
+    SUBCASE("Unknown names are still errors") {
+        calc_program *program = nullptr;
+        int position = -1;
+        CHECK(
+            calc_compile_columns(
+                "x+xy", nullptr, variables, &program, &position
+            ) == CALC_ERROR_UNKNOWN_FUNCTION
+        );
+        CHECK(position == 4);
+        CHECK(
+            calc_compile_columns(
+                "sin(x)", nullptr, variables, &program, &position
+            ) == CALC_ERROR_EXTRA_INPUT
+        );
+        CHECK(position == 3);
+    }
+    SUBCASE("Deep expressions use smaller blocks") {
+        const int depth = 100'000;
+        const std::string parens =
+            std::string(depth, '(') + "x" + std::string(depth, ')') + "*2";
+        // `x+(x+(...(x)...))` needs a stack slot per `x`.
+        std::string nested;
+        for (int i = 0; i < depth; i++) {
+            nested += "x+(";
+        }
+        nested += "x" + std::string(depth, ')');
+        const double x[] = {1, 2, 3};
+        const double *const inputs[] = {x};
+        double out[3] = {};
+        calc_program *program = nullptr;
+        REQUIRE(
+            calc_compile_columns(
+                nested.c_str(), nullptr, variables, &program, nullptr
+            ) == 0
+        );
+        calc_eval_columns(program, 3, inputs, out);
+        CHECK(out[0] == depth + 1);
+        CHECK(out[2] == 3.0 * (depth + 1));
+        calc_free(program);
+        REQUIRE(
+            calc_compile_columns(
+                parens.c_str(), nullptr, variables, &program, nullptr
+            ) == 0
+        );
+        calc_eval_columns(program, 3, inputs, out);
+        CHECK(out[1] == 4);
+        calc_free(program);
+    }
+}
+
+namespace {
+bool same_bits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Replaces every `x` and `y` in `expr` with the signed values.
+std::string substitute(const char *expr, double x, double y) {
+    std::string result;
+    for (; *expr != '\0'; expr++) {
+        if (*expr != 'x' && *expr != 'y') {
+            result += *expr;
+            continue;
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%+.17g", *expr == 'x' ? x : y);
+        result += buffer;
+    }
+    return result;
+}
+}  // namespace
+
+TEST_CASE("Backends") {
+    const char *const variables[] = {"x", "y", nullptr};
+    for (const char *expr :
+         {"2*x+1", "x*3-y", "0.1*y-7", "1+x*0.1+y/x", "(x-1)*(y+2)/3",
+          "sin(x)*2+cos(y)*y-4", "x/y-0.5*x+y*2-1", "pow(x,2)-x*x+y",
+          "x*y+x", "3-x*2"}) {
+        CAPTURE(expr);
+        calc_program *program = nullptr;
+        REQUIRE(
+            calc_compile_columns(expr, nullptr, variables, &program, nullptr) ==
+            0
+        );
+        const int rows = 300;
+        std::vector<double> x(rows);
+        std::vector<double> y(rows);
+        for (int row = 0; row < rows; row++) {
+            x[row] = (row - 150) * 0.37;
+            y[row] = 1.0 / (row + 1);
+        }
+        const double *const inputs[] = {x.data(), y.data()};
+        std::vector<double> out(rows);
+        calc_eval_columns(program, rows, inputs, out.data());
+        for (int row = 0; row < rows; row++) {
+            CAPTURE(row);
+            const double values[] = {x[row], y[row]};
+            double threaded = 0;
+            const calc_backend backend =
+                calc_set_backend(program, CALC_BACKEND_THREADED);
+            CHECK(
+                (backend == CALC_BACKEND_THREADED ||
+                 backend == CALC_BACKEND_SWITCH)
+            );
+            calc_run_variables(program, values, &threaded);
+            double switched = 0;
+            REQUIRE(
+                calc_set_backend(program, CALC_BACKEND_SWITCH) ==
+                CALC_BACKEND_SWITCH
+            );
+            calc_run_variables(program, values, &switched);
+            calc_result res;
+            REQUIRE(
+                calc_evaluate(substitute(expr, x[row], y[row]).c_str(), &res) ==
+                0
+            );
+            CHECK(same_bits(threaded, res.value));
+            CHECK(same_bits(switched, res.value));
+            CHECK(same_bits(out[row], res.value));
+        }
+        calc_free(program);
+    }
+}
+
+TEST_CASE("Optimized programs") {
+    const char *const variables[] = {"x", "y", nullptr};
+    SUBCASE("Pure functions are called once per distinct arguments") {
+        static int calls = 0;
+        calc_function funcs[] = {
+            {"sq",
+             1 | CALC_PURE,
+             {.func1 = [](double x) { return ++calls, x * x; }}},
+            CALC_FUNCTIONS_SENTINEL,
+        };
+        calls = 0;
+        calc_program *program = nullptr;
+        REQUIRE(
+            calc_compile_columns(
+                "sq(x)+sq(x)*sq(x)-sq(y)/sq(x+0)+sq(3)*sq(1+2)", funcs,
+                variables, &program, nullptr
+            ) == 0
+        );
+        CHECK(calls == 2);  // `sq(3)` and `sq(1+2)` are folded.
+        const double values[] = {2, 4};
+        double value = 0;
+        calc_run_variables(program, values, &value);
+        CHECK(value == 4 + 16 - 16.0 / 4 + 81);
+        CHECK(calls == 5);
+        calc_free(program);
+    }
+    SUBCASE("Same results as without optimizations") {
+        const std::string parts[] = {
+            "pow(x,2)", "sin(y)", "(x-y)", "x/3", "sqrt(x*x+y*y)",
+            "cos(0.5)", "(0-0)", "-0.0", "x", "y",
+        };
+        const char ops[] = {'+', '-', '*', '/'};
+        std::mt19937 gen(42);
+        for (int formula = 0; formula < 300; formula++) {
+            std::string expr = parts[gen() % std::size(parts)];
+            for (int term = 1 + static_cast<int>(gen() % 12); term > 0;
+                 term--) {
+                std::string part = parts[gen() % std::size(parts)];
+                if (gen() % 3 == 0) {
+                    part = "(" + expr + ")";
+                }
+                expr = expr + ops[gen() % std::size(ops)] + part;
+            }
+            CAPTURE(expr);
+            calc_program *program = nullptr;
+            REQUIRE(
+                calc_compile_columns(
+                    expr.c_str(), nullptr, variables, &program, nullptr
+                ) == 0
+            );
+            const double x[] = {1.5, -2, 0, 1e300, -0.0};
+            const double y[] = {0.25, 3, -0.0, 1e-300, 7};
+            const double *const inputs[] = {x, y};
+            double out[std::size(x)];
+            calc_eval_columns(program, std::size(x), inputs, out);
+            for (std::size_t row = 0; row < std::size(x); row++) {
+                CAPTURE(row);
+                calc_result expected;
+                REQUIRE(
+                    calc_evaluate(
+                        substitute(expr.c_str(), x[row], y[row]).c_str(),
+                        &expected
+                    ) == 0
+                );
+                const double values[] = {x[row], y[row]};
+                double value = 0;
+                calc_run_variables(program, values, &value);
+                CHECK(same_bits(value, expected.value));
+                CHECK(same_bits(out[row], expected.value));
+            }
+            calc_free(program);
+        }
+    }
+}
+
+TEST_CASE("Caller-supplied arena") {
+    // One byte more to check unaligned arenas.
+    alignas(std::max_align_t) std::array<unsigned char, 2049> arena{};
+    SUBCASE("Same results and errors as evaluate") {
+        for (const char *expr :
+             {"1+2*3", "2*sqrt(16)-pow(2,3)/4", "((((1))))*(2+(3*(4-5)))",
+              "", "1+", "pow(1 2)", "((1)", "2*abc(1)"}) {
+            CAPTURE(expr);
+            calc_result expected;
+            const calc_error error = calc_evaluate(expr, &expected);
+            calc_result res;
+            REQUIRE(
+                calc_evaluate_arena(
+                    expr, &res, nullptr, arena.data() + 1, arena.size() - 1
+                ) == error
+            );
+            if (error == 0) {
+                CHECK(res.value == expected.value);
+            } else {
+                CHECK(res.error_position == expected.error_position);
+            }
+        }
+    }
+    SUBCASE("Too small") {
+        calc_result res;
+        REQUIRE(
+            calc_evaluate_arena("1+2", &res, nullptr, arena.data(), 0) ==
+            CALC_ERROR_ARENA_TOO_SMALL
+        );
+        CHECK(res.error_position == 0);
+
+        const int depth = 1'000;
+        const std::string expr =
+            std::string(depth, '(') + "1" + std::string(depth, ')');
+        REQUIRE(
+            calc_evaluate_arena(
+                expr.c_str(), &res, nullptr, arena.data(), arena.size()
+            ) == CALC_ERROR_ARENA_TOO_SMALL
+        );
+        CHECK(res.error_position > 0);
+        CHECK(res.error_position < depth);
+
+        std::vector<unsigned char> big_arena(depth * 16);
+        REQUIRE(
+            calc_evaluate_arena(
+                expr.c_str(), &res, nullptr, big_arena.data(),
+                big_arena.size()
+            ) == 0
+        );
+        CHECK(res.value == 1);
+    }
+}
+
+namespace {
+// Checks that the document gives exactly the same result as evaluating its
+// text from scratch.
+void check_document(
+    calc_document *doc,
+    calc_error error,
+    calc_result res,
+    const calc_function *functions = nullptr
+) {
+    const std::string text = calc_document_text(doc);
+    CAPTURE(text);
+    calc_result expected;
+    REQUIRE(error == calc_evaluate(text.c_str(), &expected, functions));
+    calc_result stored;
+    REQUIRE(calc_document_result(doc, &stored) == error);
+    if (error != 0) {
+        CHECK(res.error_position == expected.error_position);
+        CHECK(stored.error_position == expected.error_position);
+    } else if (std::isnan(expected.value)) {
+        CHECK(std::isnan(res.value));
+    } else {
+        CHECK(res.value == expected.value);
+        CHECK(stored.value == expected.value);
+    }
+}
+}  // namespace
+
+TEST_CASE("Documents") {
+    SUBCASE("Same results as evaluate after every edit") {
+        const char *const initial =
+            "pow(sin(1+2)*3, (4-5)/6) + sqrt((7)) * (8-(9))";
+        calc_document *doc = calc_document_create(initial, nullptr);
+        REQUIRE(doc != nullptr);
+        std::mt19937 gen(12345);
+        const std::string tokens[] = {
+            "0", "1", "2", "9", ".", "+", "-", "*", "/", "(", ")", ",",
+            " ", "sin(", "pow(", "e", "x", "1+2", "(3)", "*4", ")+(",
+        };
+        int invalid_edits = 0;
+        for (int step = 0; step < 20'000; step++) {
+            const std::string text = calc_document_text(doc);
+            std::size_t offset = gen() % (text.size() + 1);
+            std::size_t deleted = 0;
+            std::string inserted;
+            if (invalid_edits > 3) {
+                // Start over, so that most edits change a valid expression.
+                offset = 0;
+                deleted = text.size();
+                inserted = initial;
+            } else if (gen() % 2 == 0) {
+                // Replacing a digit keeps the expression valid.
+                const std::size_t digit =
+                    text.find_first_of("0123456789", offset);
+                if (digit != std::string::npos) {
+                    offset = digit;
+                    deleted = 1;
+                }
+                inserted = std::to_string(gen() % 10);
+            } else {
+                if (text.size() > 60 || gen() % 3 == 0) {
+                    deleted = std::min<std::size_t>(
+                        text.size() - offset, gen() % 4
+                    );
+                }
+                if (text.size() < 120 && gen() % 4 != 0) {
+                    inserted = tokens[gen() % std::size(tokens)];
+                }
+            }
+            CAPTURE(offset);
+            CAPTURE(deleted);
+            CAPTURE(inserted);
+            calc_result res;
+            const calc_error error = calc_document_edit(
+                doc, offset, deleted, inserted.c_str(), &res
+            );
+            check_document(doc, error, res);
+            invalid_edits = error == 0 ? 0 : invalid_edits + 1;
+        }
+        calc_document_free(doc);
+    }
+    SUBCASE("Only dependent operations are evaluated") {
+        static int calls = 0;
+        calc_function funcs[] = {
+            {"f", 1, {.func1 = [](double x) { return ++calls, x; }}},
+            {"g",
+             2,
+             {.func2 = [](double x, double y) { return ++calls, x * y; }}},
+            CALC_FUNCTIONS_SENTINEL,
+        };
+        calls = 0;
+        calc_document *doc = calc_document_create("f(1)+g(f(2),3)*(4)", funcs);
+        REQUIRE(doc != nullptr);
+        CHECK(calls == 3);
+        calc_result res;
+        REQUIRE(calc_document_edit(doc, 16, 1, "5", &res) == 0);
+        CHECK(res.value == 31);
+        CHECK(calls == 3);
+        REQUIRE(calc_document_edit(doc, 12, 1, "7", &res) == 0);
+        CHECK(res.value == 71);
+        CHECK(calls == 4);
+        REQUIRE(calc_document_edit(doc, 10, 0, "+1", &res) == 0);
+        CHECK(std::string(calc_document_text(doc)) == "f(1)+g(f(2+1),7)*(5)");
+        CHECK(res.value == 106);
+        CHECK(calls == 6);
+        check_document(
+            doc, calc_document_edit(doc, 18, 0, ")", &res), res, funcs
+        );
+        REQUIRE(calc_document_edit(doc, 18, 1, "", &res) == 0);
+        CHECK(res.value == 106);
+        calc_document_free(doc);
+    }
+    SUBCASE("Deep expressions") {
+        const int depth = 100'000;
+        std::string expr;
+        for (int i = 0; i < depth; i++) {
+            expr += "1+(";
+        }
+        expr += '1' + std::string(depth, ')');
+        calc_document *doc = calc_document_create(expr.c_str(), nullptr);
+        REQUIRE(doc != nullptr);
+        calc_result res;
+        REQUIRE(calc_document_result(doc, &res) == 0);
+        CHECK(res.value == depth + 1);
+        REQUIRE(calc_document_edit(doc, 3 * depth, 1, "2", &res) == 0);
+        CHECK(res.value == depth + 2);
+        REQUIRE(calc_document_edit(doc, 0, 2, "", &res) == 0);
+        CHECK(res.value == depth + 1);
+        calc_document_free(doc);
+    }
+}
 #endif  // TEST_COMPLEX_EXPRESSIONS
 
 // NOLINTEND(misc-use-anonymous-namespace)
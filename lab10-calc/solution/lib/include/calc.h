@@ -1 +1,213 @@
-// TODO
+#ifndef CALC_H_
+#define CALC_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { CALC_MAX_ARITY = 5 };
+
+// Or-ed into `arity` of a function which has no side effects and returns the
+// same result for the same arguments.  Then compiled programs call it once
+// for identical arguments and fold its calls with constant arguments.
+enum { CALC_PURE = 0x100 };
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4201)  // Anonymous unions are standard since C11.
+#endif
+
+typedef struct calc_function {
+    const char *name;
+    int arity;
+    union {
+        double (*func0)(void);
+        double (*func1)(double);
+        double (*func2)(double, double);
+        double (*func3)(double, double, double);
+        double (*func4)(double, double, double, double);
+        double (*func5)(double, double, double, double, double);
+    };
+} calc_function;
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#ifdef __cplusplus
+#define CALC_FUNCTIONS_SENTINEL \
+    { nullptr, 0, { nullptr } }
+#else
+#define CALC_FUNCTIONS_SENTINEL \
+    { NULL, 0, { NULL } }
+#endif
+
+typedef enum calc_error {
+    CALC_ERROR_OK = 0,
+    CALC_ERROR_BAD_NUMBER = 1,
+    CALC_ERROR_UNKNOWN_FUNCTION = 2,
+    CALC_ERROR_EXPECTED_OPEN_PAREN = 3,
+    CALC_ERROR_EXPECTED_COMMA = 4,
+    CALC_ERROR_EXPECTED_CLOSE_PAREN = 5,
+    CALC_ERROR_UNEXPECTED_CHAR = 6,
+    CALC_ERROR_EXTRA_INPUT = 7,
+    CALC_ERROR_OUT_OF_MEMORY = 8,
+    CALC_ERROR_ARENA_TOO_SMALL = 9,
+} calc_error;
+
+// Only one of the fields is meaningful: `value` on success, `error_position`
+// otherwise.
+typedef union calc_result {
+    double value;
+    int error_position;
+} calc_result;
+
+// `functions` is terminated by `CALC_FUNCTIONS_SENTINEL`.  If it is null,
+// `sqrt`, `sin`, `cos` and `pow` are available.
+#ifdef __cplusplus
+calc_error calc_evaluate(
+    const char *expr,
+    calc_result *res,
+    const calc_function *functions = nullptr
+);
+#else
+calc_error calc_evaluate(
+    const char *expr,
+    calc_result *res,
+    const calc_function *functions
+);
+#endif
+
+// Like `calc_evaluate`, but never allocates: all scratch memory comes from
+// `arena_size` bytes at `arena`, which need no particular alignment.  If
+// they are not enough, returns `CALC_ERROR_ARENA_TOO_SMALL` with the position
+// where parsing stopped.  Buffers take about 16 bytes per pending operand and
+// 12 bytes per nesting level and grow by doubling, so the arena should be a
+// few times larger; 2 KiB is plenty for typical expressions.
+calc_error calc_evaluate_arena(
+    const char *expr,
+    calc_result *res,
+    const calc_function *functions,
+    void *arena,
+    size_t arena_size
+);
+
+// A set of functions hashed once by name, so that every call site in an
+// expression is resolved in O(1) instead of a linear scan over the array.
+// Prepare it once when evaluating many expressions with the same functions.
+typedef struct calc_function_table calc_function_table;
+
+// Copies `functions` (including names), which may be null for the default
+// set.  Returns null if memory cannot be allocated.
+calc_function_table *calc_functions_prepare(const calc_function *functions);
+
+void calc_functions_free(calc_function_table *table);
+
+calc_error calc_evaluate_prepared(
+    const char *expr,
+    calc_result *res,
+    const calc_function_table *table
+);
+
+// An expression parsed once into postfix code: operations on constants are
+// folded, identical subexpressions are computed once and functions are
+// resolved to pointers, so running it again is much cheaper than
+// `calc_evaluate`.  The results are exactly the same.  Functions which are
+// not `CALC_PURE` are called on each run as many times as they are written.
+typedef struct calc_program calc_program;
+
+// On success stores a new program to `*program`, otherwise stores null and,
+// if `error_position` is not null, the same position as `calc_evaluate`.
+calc_error calc_compile(
+    const char *expr,
+    const calc_function *functions,
+    calc_program **program,
+    int *error_position
+);
+
+// Like `calc_compile`, but names from `variables`, which is terminated with
+// a null pointer, denote columns of `calc_eval_columns` inputs.  A variable
+// shadows a function with the same name.
+calc_error calc_compile_columns(
+    const char *expr,
+    const calc_function *functions,
+    const char *const *variables,
+    calc_program **program,
+    int *error_position
+);
+
+// Uses scratch memory inside `program`, so a program cannot be run by
+// several threads at once.  Variables are NaN here.
+void calc_run(calc_program *program, double *result);
+
+// Like `calc_run`, but the i-th variable is `variables[i]`.
+void calc_run_variables(
+    calc_program *program,
+    const double *variables,
+    double *result
+);
+
+// How `calc_run` dispatches instructions.  Both give identical results.
+typedef enum calc_backend {
+    CALC_BACKEND_SWITCH = 0,  // A loop over a `switch`, available everywhere.
+    // Each instruction jumps to the next one directly with computed `goto`,
+    // available with GCC-compatible compilers.  Used by default if available.
+    CALC_BACKEND_THREADED = 1,
+} calc_backend;
+
+// Returns the backend actually selected, which is `CALC_BACKEND_SWITCH` if
+// `backend` is not available.
+calc_backend calc_set_backend(calc_program *program, calc_backend backend);
+
+// Computes `out[row]` for each `row < n_rows` with the i-th variable equal to
+// `inputs[i][row]`.  Each instruction runs as a loop over a block of rows, so
+// the interpretation overhead is paid once per block instead of once per row.
+// Like `calc_run`, uses scratch memory inside `program`.
+void calc_eval_columns(
+    calc_program *program,
+    size_t n_rows,
+    const double *const *inputs,
+    double *out
+);
+
+void calc_free(calc_program *program);
+
+// An expression which is edited in place, e.g. on every keystroke in a UI.
+// It keeps the parse tree with the result of every operation, so an edit
+// parses again only the innermost parenthesized expression or function
+// argument containing it and evaluates again only the operations depending
+// on it.  Functions are thus called only if their arguments may have
+// changed.
+typedef struct calc_document calc_document;
+
+// `functions`, which may be null for the default set, must outlive the
+// document.  Returns null if memory cannot be allocated.
+calc_document *
+calc_document_create(const char *expr, const calc_function *functions);
+
+// Replaces `deleted` characters at `offset` with `inserted`, both must be
+// within the text.  Returns the same as `calc_evaluate` for the new text and
+// stores the result to `*res` if it is not null.  If memory runs out,
+// returns `CALC_ERROR_OUT_OF_MEMORY` and the text may or may not be edited.
+calc_error calc_document_edit(
+    calc_document *doc,
+    size_t offset,
+    size_t deleted,
+    const char *inserted,
+    calc_result *res
+);
+
+// The result of the last edit without evaluating anything.
+calc_error calc_document_result(const calc_document *doc, calc_result *res);
+
+const char *calc_document_text(const calc_document *doc);
+
+void calc_document_free(calc_document *doc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CALC_H_
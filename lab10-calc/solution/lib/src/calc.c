@@ -1 +1,1837 @@
-// TODO
+#include "calc.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parse_double.h"
+
+static const calc_function default_functions[] = {
+    {.name = "sqrt", .arity = 1 | CALC_PURE, .func1 = sqrt},
+    {.name = "sin", .arity = 1 | CALC_PURE, .func1 = sin},
+    {.name = "cos", .arity = 1 | CALC_PURE, .func1 = cos},
+    {.name = "pow", .arity = 2 | CALC_PURE, .func2 = pow},
+    CALC_FUNCTIONS_SENTINEL,
+};
+
+typedef struct table_slot {
+    uint32_t hash;
+    uint32_t index_plus_one;  // Zero for an empty slot.
+} table_slot;
+
+struct calc_function_table {
+    size_t mask;  // Number of slots minus one, slots are a power of two.
+    table_slot *slots;
+    calc_function *functions;
+};
+
+static uint32_t hash_name(const char *name, size_t length) {
+    // FNV-1a.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+calc_function_table *calc_functions_prepare(const calc_function *functions) {
+    if (functions == NULL) {
+        functions = default_functions;
+    }
+    size_t count = 0;
+    size_t names_size = 0;
+    for (; functions[count].name != NULL; count++) {
+        names_size += strlen(functions[count].name) + 1;
+    }
+    size_t slots_count = 8;
+    while (slots_count < 2 * count) {
+        slots_count *= 2;
+    }
+
+    // One allocation for everything, names are stored after the slots.
+    size_t size = sizeof(calc_function_table) +
+                  slots_count * sizeof(table_slot) +
+                  count * sizeof(calc_function) + names_size;
+    calc_function_table *table = malloc(size);
+    if (table == NULL) {
+        return NULL;
+    }
+    table->mask = slots_count - 1;
+    table->slots = (table_slot *)(table + 1);
+    table->functions = (calc_function *)(table->slots + slots_count);
+    char *names = (char *)(table->functions + count);
+    memset(table->slots, 0, slots_count * sizeof(table_slot));
+
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(functions[i].name);
+        table->functions[i] = functions[i];
+        table->functions[i].name = memcpy(names, functions[i].name, length + 1);
+        names += length + 1;
+
+        uint32_t hash = hash_name(functions[i].name, length);
+        size_t slot = hash & table->mask;
+        while (table->slots[slot].index_plus_one != 0) {
+            slot = (slot + 1) & table->mask;
+        }
+        table->slots[slot].hash = hash;
+        table->slots[slot].index_plus_one = (uint32_t)(i + 1);
+    }
+    return table;
+}
+
+void calc_functions_free(calc_function_table *table) {
+    free(table);
+}
+
+static const calc_function *
+table_find(const calc_function_table *table, const char *name, size_t length) {
+    uint32_t hash = hash_name(name, length);
+    for (size_t slot = hash & table->mask;
+         table->slots[slot].index_plus_one != 0;
+         slot = (slot + 1) & table->mask) {
+        if (table->slots[slot].hash != hash) {
+            continue;
+        }
+        const calc_function *f =
+            &table->functions[table->slots[slot].index_plus_one - 1];
+        if (strncmp(f->name, name, length) == 0 && f->name[length] == '\0') {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+typedef enum opcode {
+    OP_PUSH,
+    OP_VAR,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_CALL0,  // `OP_CALL0 + arity` calls a function with that many arguments.
+    OP_CALL1,
+    OP_CALL2,
+    OP_CALL3,
+    OP_CALL4,
+    OP_CALL5,
+    // Copy the topmost operand to a slot of shared subexpressions and push a
+    // copy back from it.
+    OP_SAVE,
+    OP_LOAD,
+    // Superinstructions produced by `fuse_instructions`.  `OP_ADD_CONST +
+    // (op - OP_ADD)` applies `op` to the topmost operand and a constant,
+    // `OP_ADD_VAR + (op - OP_ADD)` to the topmost operand and a variable.
+    OP_ADD_CONST,
+    OP_SUB_CONST,
+    OP_MUL_CONST,
+    OP_DIV_CONST,
+    OP_ADD_VAR,
+    OP_SUB_VAR,
+    OP_MUL_VAR,
+    OP_DIV_VAR,
+    // Pushes `c * variable + d`, where `c` and `d` are the values of the two
+    // following `OP_DATA` instructions.
+    OP_AFFINE,
+    OP_DATA,
+    OP_END,  // Terminates the code of a program.
+} opcode;
+
+typedef struct instruction {
+    opcode op;
+    bool pure;  // Whether a called function is `CALC_PURE`.
+    union {
+        double value;
+        size_t column;  // Also the slot of `OP_SAVE` and `OP_LOAD`.
+        double (*func0)(void);
+        double (*func1)(double);
+        double (*func2)(double, double);
+        double (*func3)(double, double, double);
+        double (*func4)(double, double, double, double);
+        double (*func5)(double, double, double, double, double);
+    };
+} instruction;
+
+#if defined(__GNUC__)
+#define HAVE_COMPUTED_GOTO
+#endif
+
+struct calc_program {
+    size_t size;  // Not counting the final `OP_END`.
+    bool threaded;
+    // Scratch space placed after `code`: one operand per stack slot for
+    // `calc_run` and `block_rows` of them for `calc_eval_columns`.
+    double *stack;
+    double *block_stack;
+    size_t block_rows;
+    double *nan_variables;  // The values of variables for `calc_run`.
+    // Slots of shared subexpressions, `block_rows` of them per slot for
+    // `calc_eval_columns`.
+    double *slots;
+    double *block_slots;
+    instruction code[];
+};
+
+// Rows of a block in `calc_eval_columns` unless the stack and the slots need
+// more than `BLOCK_STACK_SIZE` operands for that.
+enum { MAX_BLOCK_ROWS = 256, BLOCK_STACK_SIZE = 1 << 16 };
+
+typedef enum frame_kind {
+    FRAME_WHOLE,  // The whole expression.
+    FRAME_PAREN,  // Inside `(...)`.
+    FRAME_CALL,   // An argument of a function call.
+} frame_kind;
+
+// An `<expr-1>` being parsed along with the operators waiting for their right
+// operand.  Frames live on the heap instead of the call stack, so the nesting
+// depth is limited only by memory.
+typedef struct frame {
+    unsigned char kind;
+    char add_op;  // `+`, `-` or zero.
+    char mul_op;  // `*`, `/` or zero.
+    unsigned char args_read;
+} frame;
+
+// A part of the expression parsed as a whole `<expr>`: a parenthesized
+// expression or a function argument.  Recorded only for documents.
+typedef struct group {
+    size_t start;
+    size_t end;  // The closing delimiter.
+    // The last instruction of the `<expr>`, or the enclosing open group while
+    // the parser is still inside this one.
+    size_t node;
+} group;
+
+// Scratch memory for the buffers of a parser.  They are carved from `data`
+// and, once it is exhausted, move to the heap if `heap` is set.
+typedef struct arena {
+    unsigned char *data;
+    size_t size;
+    size_t used;
+    bool heap;
+} arena;
+
+// Enough for expressions with a few dozen pending operands and nested
+// parentheses, so that typical evaluations do not allocate at all.
+enum { INTERNAL_ARENA_SIZE = 2048 };
+
+typedef struct parser {
+    const char *expr;
+    const char *cur;
+    const char *end;  // Null if the expression ends at the terminating zero.
+    const char *error_at;
+    // Exactly one of them is non-null.
+    const calc_function *functions;
+    const calc_function_table *table;
+    const char *const *variables;  // May be null.
+    // Postfix code emitted so far.  Operations on constants are folded right
+    // away, so when calls are folded as well the code is a single constant
+    // per pending operand and evaluation needs no separate pass.
+    bool fold_calls;
+    // Set for documents: nothing is folded, so every operation of the
+    // expression gets its own instruction, and `groups` are recorded.
+    bool keep_tree;
+    instruction *code;
+    size_t code_size;
+    size_t code_capacity;
+    size_t depth;
+    size_t max_depth;
+    // Frames of nested expressions and functions of `FRAME_CALL` frames.
+    frame *frames;
+    size_t frames_size;
+    size_t frames_capacity;
+    const calc_function **calls;
+    size_t calls_size;
+    size_t calls_capacity;
+    group *groups;
+    size_t groups_size;
+    size_t groups_capacity;
+    size_t open_group;  // The innermost open group or `SIZE_MAX`.
+    arena arena;
+} parser;
+
+static const calc_function *
+find_function(const parser *p, const char *name, size_t length) {
+    if (p->table != NULL) {
+        return table_find(p->table, name, length);
+    }
+    for (const calc_function *f = p->functions; f->name != NULL; f++) {
+        if (strncmp(f->name, name, length) == 0 && f->name[length] == '\0') {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+// Returns the index of the variable or `SIZE_MAX` if there is none.
+static size_t find_variable(const parser *p, const char *name, size_t length) {
+    if (p->variables == NULL) {
+        return SIZE_MAX;
+    }
+    for (size_t i = 0; p->variables[i] != NULL; i++) {
+        const char *v = p->variables[i];
+        if (strncmp(v, name, length) == 0 && v[length] == '\0') {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+static calc_error fail(parser *p, calc_error error) {
+    p->error_at = p->cur;
+    return error;
+}
+
+static calc_error out_of_memory(parser *p) {
+    return fail(
+        p, p->arena.heap ? CALC_ERROR_OUT_OF_MEMORY : CALC_ERROR_ARENA_TOO_SMALL
+    );
+}
+
+static void skip_spaces(parser *p) {
+    while (isspace((unsigned char)*p->cur)) {
+        p->cur++;
+    }
+}
+
+static int function_arity(const calc_function *f) {
+    return f->arity & ~CALC_PURE;
+}
+
+static double call(const calc_function *f, const double *args) {
+    switch (function_arity(f)) {
+        case 0:
+            return f->func0();
+        case 1:
+            return f->func1(args[0]);
+        case 2:
+            return f->func2(args[0], args[1]);
+        case 3:
+            return f->func3(args[0], args[1], args[2]);
+        case 4:
+            return f->func4(args[0], args[1], args[2], args[3]);
+        default:
+            return f->func5(args[0], args[1], args[2], args[3], args[4]);
+    }
+}
+
+static double apply(opcode op, double lhs, double rhs) {
+    switch (op) {
+        case OP_ADD:
+            return lhs + rhs;
+        case OP_SUB:
+            return lhs - rhs;
+        case OP_MUL:
+            return lhs * rhs;
+        default:
+            return lhs / rhs;
+    }
+}
+
+// The number of operands which an instruction of the parser pops.
+static size_t arity_of(opcode op) {
+    if (op >= OP_ADD && op <= OP_DIV) {
+        return 2;
+    }
+    return op >= OP_CALL0 && op <= OP_CALL5 ? (size_t)(op - OP_CALL0) : 0;
+}
+
+static bool in_arena(const arena *a, const void *data) {
+    uintptr_t address = (uintptr_t)data;
+    uintptr_t begin = (uintptr_t)a->data;
+    return data != NULL && address >= begin && address - begin < a->size;
+}
+
+// Returns `size` bytes from the arena aligned for any buffer or null if they
+// do not fit.
+static void *arena_allocate(arena *a, size_t size) {
+    if (a->size == 0) {
+        // Also avoids adding zero to a null pointer.
+        return NULL;
+    }
+    const uintptr_t alignment = _Alignof(max_align_t);
+    uintptr_t address = (uintptr_t)(a->data + a->used);
+    size_t padding = (size_t)(-address & (alignment - 1));
+    if (padding > a->size - a->used || size > a->size - a->used - padding) {
+        return NULL;
+    }
+    void *data = a->data + a->used + padding;
+    a->used += padding + size;
+    return data;
+}
+
+// Doubles a full buffer of `*capacity` elements, which may be null if the
+// capacity is zero.  Buffers stay in the arena while they fit there and
+// move to the heap afterwards if it is allowed.  Returns the new buffer or
+// null if memory cannot be allocated, then the old one is still valid.
+static void *
+grow_buffer(arena *a, void *data, size_t *capacity, size_t elem_size) {
+    if (*capacity > SIZE_MAX / 2 / elem_size) {
+        return NULL;
+    }
+    size_t new_capacity = *capacity == 0 ? 16 : *capacity * 2;
+    size_t old_size = *capacity * elem_size;
+    size_t new_size = new_capacity * elem_size;
+    void *new_data = NULL;
+    if (data != NULL && !in_arena(a, data)) {
+        new_data = realloc(data, new_size);
+    } else if (data != NULL &&
+               (unsigned char *)data + old_size == a->data + a->used &&
+               new_size - old_size <= a->size - a->used) {
+        // The most recent buffer grows in place.
+        a->used += new_size - old_size;
+        new_data = data;
+    } else {
+        new_data = arena_allocate(a, new_size);
+        if (new_data == NULL && a->heap) {
+            new_data = malloc(new_size);
+        }
+        if (new_data != NULL && old_size > 0) {
+            memcpy(new_data, data, old_size);
+        }
+    }
+    if (new_data != NULL) {
+        *capacity = new_capacity;
+    }
+    return new_data;
+}
+
+static void free_buffer(const arena *a, void *data) {
+    if (!in_arena(a, data)) {
+        free(data);
+    }
+}
+
+static bool reserve_instruction(parser *p) {
+    if (p->code_size < p->code_capacity) {
+        return true;
+    }
+    instruction *new_code = grow_buffer(
+        &p->arena, p->code, &p->code_capacity, sizeof(instruction)
+    );
+    if (new_code == NULL) {
+        return false;
+    }
+    p->code = new_code;
+    return true;
+}
+
+// Whether the last `count` instructions are constants.  Then they are exactly
+// the `count` topmost operands, as every operand ends with the instruction
+// pushing it.
+static bool is_constant(const parser *p, size_t count) {
+    if (p->code_size < count) {
+        return false;
+    }
+    for (size_t i = p->code_size - count; i < p->code_size; i++) {
+        if (p->code[i].op != OP_PUSH) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void grow_depth(parser *p, size_t pushed, size_t popped) {
+    p->depth = p->depth + pushed - popped;
+    if (p->max_depth < p->depth) {
+        p->max_depth = p->depth;
+    }
+}
+
+static calc_error emit_push(parser *p, double value) {
+    if (!reserve_instruction(p)) {
+        return out_of_memory(p);
+    }
+    instruction *instr = &p->code[p->code_size++];
+    instr->op = OP_PUSH;
+    instr->value = value;
+    grow_depth(p, 1, 0);
+    return CALC_ERROR_OK;
+}
+
+static calc_error emit_variable(parser *p, size_t column) {
+    if (!reserve_instruction(p)) {
+        return out_of_memory(p);
+    }
+    instruction *instr = &p->code[p->code_size++];
+    instr->op = OP_VAR;
+    instr->column = column;
+    grow_depth(p, 1, 0);
+    return CALC_ERROR_OK;
+}
+
+static calc_error emit_binary(parser *p, opcode op) {
+    if (!p->keep_tree && is_constant(p, 2)) {
+        double rhs = p->code[--p->code_size].value;
+        instruction *lhs = &p->code[p->code_size - 1];
+        lhs->value = apply(op, lhs->value, rhs);
+        grow_depth(p, 0, 1);
+        return CALC_ERROR_OK;
+    }
+    if (!reserve_instruction(p)) {
+        return out_of_memory(p);
+    }
+    p->code[p->code_size++].op = op;
+    grow_depth(p, 0, 1);
+    return CALC_ERROR_OK;
+}
+
+static calc_error emit_call(parser *p, const calc_function *f) {
+    size_t arity = (size_t)function_arity(f);
+    bool pure = (f->arity & CALC_PURE) != 0;
+    if (!p->keep_tree && (p->fold_calls || pure) && is_constant(p, arity)) {
+        double args[CALC_MAX_ARITY];
+        p->code_size -= arity;
+        for (size_t i = 0; i < arity; i++) {
+            args[i] = p->code[p->code_size + i].value;
+        }
+        grow_depth(p, 0, arity);
+        return emit_push(p, call(f, args));
+    }
+    if (!reserve_instruction(p)) {
+        return out_of_memory(p);
+    }
+    instruction *instr = &p->code[p->code_size++];
+    instr->op = (opcode)(OP_CALL0 + arity);
+    instr->pure = pure;
+    switch (arity) {
+        case 0:
+            instr->func0 = f->func0;
+            break;
+        case 1:
+            instr->func1 = f->func1;
+            break;
+        case 2:
+            instr->func2 = f->func2;
+            break;
+        case 3:
+            instr->func3 = f->func3;
+            break;
+        case 4:
+            instr->func4 = f->func4;
+            break;
+        default:
+            instr->func5 = f->func5;
+            break;
+    }
+    grow_depth(p, 1, arity);
+    return CALC_ERROR_OK;
+}
+
+static calc_error push_frame(parser *p, frame_kind kind) {
+    if (p->frames_size == p->frames_capacity) {
+        frame *new_frames = grow_buffer(
+            &p->arena, p->frames, &p->frames_capacity, sizeof(frame)
+        );
+        if (new_frames == NULL) {
+            return out_of_memory(p);
+        }
+        p->frames = new_frames;
+    }
+    frame *f = &p->frames[p->frames_size++];
+    f->kind = (unsigned char)kind;
+    f->add_op = 0;
+    f->mul_op = 0;
+    f->args_read = 0;
+    return CALC_ERROR_OK;
+}
+
+static calc_error push_call(parser *p, const calc_function *f) {
+    if (p->calls_size == p->calls_capacity) {
+        const calc_function **new_calls = grow_buffer(
+            &p->arena, p->calls, &p->calls_capacity, sizeof(*p->calls)
+        );
+        if (new_calls == NULL) {
+            return out_of_memory(p);
+        }
+        p->calls = new_calls;
+    }
+    p->calls[p->calls_size++] = f;
+    return push_frame(p, FRAME_CALL);
+}
+
+static calc_error open_group(parser *p) {
+    if (!p->keep_tree) {
+        return CALC_ERROR_OK;
+    }
+    if (p->groups_size == p->groups_capacity) {
+        group *new_groups = grow_buffer(
+            &p->arena, p->groups, &p->groups_capacity, sizeof(group)
+        );
+        if (new_groups == NULL) {
+            return out_of_memory(p);
+        }
+        p->groups = new_groups;
+    }
+    group *g = &p->groups[p->groups_size];
+    g->start = (size_t)(p->cur - p->expr);
+    g->end = SIZE_MAX;
+    g->node = p->open_group;
+    p->open_group = p->groups_size++;
+    return CALC_ERROR_OK;
+}
+
+// Called at the closing delimiter of the innermost open group.
+static void close_group(parser *p) {
+    if (!p->keep_tree) {
+        return;
+    }
+    group *g = &p->groups[p->open_group];
+    p->open_group = g->node;
+    g->end = (size_t)(p->cur - p->expr);
+    g->node = p->code_size - 1;
+}
+
+static opcode binary_opcode(char op) {
+    switch (op) {
+        case '+':
+            return OP_ADD;
+        case '-':
+            return OP_SUB;
+        case '*':
+            return OP_MUL;
+        default:
+            return OP_DIV;
+    }
+}
+
+// The parser is the recursive descent over the grammar from the README with
+// the recursion replaced by `frames`: it alternates between expecting an
+// `<atom>` and handling what follows a complete one.
+typedef enum parse_state {
+    EXPECT_ATOM,
+    AFTER_ATOM,
+    PARSED,
+} parse_state;
+
+static calc_error read_number(parser *p) {
+    double value = 0;
+    const char *end = calc_parse_double(p->cur, &value);
+    if (end == p->cur) {
+        return fail(p, CALC_ERROR_BAD_NUMBER);
+    }
+    p->cur = end;
+    return emit_push(p, value);
+}
+
+// A variable or the beginning of a function call.
+static calc_error start_name(parser *p, parse_state *state) {
+    const char *name = p->cur;
+    while (isalpha((unsigned char)*p->cur)) {
+        p->cur++;
+    }
+    size_t length = (size_t)(p->cur - name);
+    size_t column = find_variable(p, name, length);
+    if (column != SIZE_MAX) {
+        *state = AFTER_ATOM;
+        return emit_variable(p, column);
+    }
+    const calc_function *f = find_function(p, name, length);
+    if (f == NULL) {
+        return fail(p, CALC_ERROR_UNKNOWN_FUNCTION);
+    }
+    skip_spaces(p);
+    if (*p->cur != '(') {
+        return fail(p, CALC_ERROR_EXPECTED_OPEN_PAREN);
+    }
+    p->cur++;
+    if (function_arity(f) > 0) {
+        calc_error error = push_call(p, f);
+        return error != CALC_ERROR_OK ? error : open_group(p);
+    }
+    skip_spaces(p);
+    if (*p->cur != ')') {
+        return fail(p, CALC_ERROR_EXPECTED_CLOSE_PAREN);
+    }
+    p->cur++;
+    *state = AFTER_ATOM;
+    return emit_call(p, f);
+}
+
+static calc_error start_atom(parser *p, parse_state *state) {
+    skip_spaces(p);
+    char c = *p->cur;
+    if (c == '(') {
+        p->cur++;
+        calc_error error = push_frame(p, FRAME_PAREN);
+        return error != CALC_ERROR_OK ? error : open_group(p);
+    }
+    if (isdigit((unsigned char)c) || c == '+' || c == '-' || c == '.') {
+        *state = AFTER_ATOM;
+        return read_number(p);
+    }
+    if (isalpha((unsigned char)c)) {
+        return start_name(p, state);
+    }
+    return fail(p, CALC_ERROR_UNEXPECTED_CHAR);
+}
+
+// Called when the `<expr-1>` of the topmost frame cannot be continued.
+static calc_error finish_frame(parser *p, parse_state *state) {
+    frame *top = &p->frames[p->frames_size - 1];
+    char c = *p->cur;
+    if (top->kind == FRAME_WHOLE) {
+        if (p->end != NULL ? p->cur != p->end : c != '\0') {
+            return fail(p, CALC_ERROR_EXTRA_INPUT);
+        }
+        *state = PARSED;
+        return CALC_ERROR_OK;
+    }
+    if (top->kind == FRAME_PAREN) {
+        if (c != ')') {
+            return fail(p, CALC_ERROR_EXPECTED_CLOSE_PAREN);
+        }
+        close_group(p);
+        p->cur++;
+        p->frames_size--;
+        return CALC_ERROR_OK;
+    }
+
+    const calc_function *f = p->calls[p->calls_size - 1];
+    if (++top->args_read < function_arity(f)) {
+        if (c != ',') {
+            return fail(p, CALC_ERROR_EXPECTED_COMMA);
+        }
+        close_group(p);
+        p->cur++;
+        *state = EXPECT_ATOM;
+        return open_group(p);
+    }
+    if (c != ')') {
+        return fail(p, CALC_ERROR_EXPECTED_CLOSE_PAREN);
+    }
+    close_group(p);
+    p->cur++;
+    p->frames_size--;
+    p->calls_size--;
+    return emit_call(p, f);
+}
+
+static calc_error after_atom(parser *p, parse_state *state) {
+    frame *top = &p->frames[p->frames_size - 1];
+    calc_error error = CALC_ERROR_OK;
+    if (top->mul_op != 0) {
+        error = emit_binary(p, binary_opcode(top->mul_op));
+        top->mul_op = 0;
+        if (error != CALC_ERROR_OK) {
+            return error;
+        }
+    }
+    skip_spaces(p);
+    char c = *p->cur;
+    if (c == '*' || c == '/') {
+        top->mul_op = c;
+        p->cur++;
+        *state = EXPECT_ATOM;
+        return CALC_ERROR_OK;
+    }
+
+    // The `<expr-2>` is complete.
+    if (top->add_op != 0) {
+        error = emit_binary(p, binary_opcode(top->add_op));
+        top->add_op = 0;
+        if (error != CALC_ERROR_OK) {
+            return error;
+        }
+    }
+    if (c == '+' || c == '-') {
+        top->add_op = c;
+        p->cur++;
+        *state = EXPECT_ATOM;
+        return CALC_ERROR_OK;
+    }
+    return finish_frame(p, state);
+}
+
+// Leaves the code in `p->code`, which the caller frees with `free_buffer`.
+static calc_error parse(parser *p) {
+    calc_error error = push_frame(p, FRAME_WHOLE);
+    parse_state state = EXPECT_ATOM;
+    while (error == CALC_ERROR_OK && state != PARSED) {
+        error = state == EXPECT_ATOM ? start_atom(p, &state)
+                                     : after_atom(p, &state);
+    }
+
+    free_buffer(&p->arena, p->frames);
+    free_buffer(&p->arena, p->calls);
+    return error;
+}
+
+static calc_error evaluate(parser *p, calc_result *res) {
+    p->fold_calls = true;
+    calc_error error = parse(p);
+    if (res != NULL) {
+        if (error == CALC_ERROR_OK) {
+            res->value = p->code[0].value;
+        } else {
+            res->error_position = (int)(p->error_at - p->expr);
+        }
+    }
+    free_buffer(&p->arena, p->code);
+    return error;
+}
+
+static uint64_t mix_hash(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * 0x100000001b3;  // The FNV-1a prime.
+}
+
+// Whether nodes `a` and `b` of postfix code with value numbers `ids` of
+// subtrees and their `sizes` compute the same.  Calls are compared by
+// function, the hash does not include it.
+static bool same_node(
+    const instruction *code,
+    const size_t *ids,
+    const size_t *sizes,
+    size_t a,
+    size_t b
+) {
+    const instruction *x = &code[a];
+    const instruction *y = &code[b];
+    if (x->op != y->op) {
+        return false;
+    }
+    switch (x->op) {
+        case OP_PUSH:
+            // Bitwise, so that zeroes of different signs differ.
+            if (memcmp(&x->value, &y->value, sizeof(double)) != 0) {
+                return false;
+            }
+            break;
+        case OP_VAR:
+            if (x->column != y->column) {
+                return false;
+            }
+            break;
+        case OP_CALL0:
+            if (x->func0 != y->func0) {
+                return false;
+            }
+            break;
+        case OP_CALL1:
+            if (x->func1 != y->func1) {
+                return false;
+            }
+            break;
+        case OP_CALL2:
+            if (x->func2 != y->func2) {
+                return false;
+            }
+            break;
+        case OP_CALL3:
+            if (x->func3 != y->func3) {
+                return false;
+            }
+            break;
+        case OP_CALL4:
+            if (x->func4 != y->func4) {
+                return false;
+            }
+            break;
+        case OP_CALL5:
+            if (x->func5 != y->func5) {
+                return false;
+            }
+            break;
+        default:
+            break;
+    }
+    for (size_t i = arity_of(x->op); i-- > 0;) {
+        if (ids[a - 1] != ids[b - 1]) {
+            return false;
+        }
+        a -= sizes[a - 1];
+        b -= sizes[b - 1];
+    }
+    return true;
+}
+
+// Computes subexpressions which occur several times only once: the first
+// occurrence is followed by `OP_SAVE` to a slot and the others are replaced
+// with `OP_LOAD` from it.  Subexpressions with calls of functions which are
+// not `CALC_PURE` are never shared.  Returns the new size, which is never
+// larger, or `SIZE_MAX` if memory cannot be allocated, and stores the number
+// of slots to `*slots_count`.
+static size_t
+share_subexpressions(instruction *code, size_t size, size_t *slots_count) {
+    *slots_count = 0;
+    size_t table_size = 1;
+    while (table_size < 2 * size) {
+        table_size *= 2;
+    }
+    // A node is a duplicate if its value number differs from its index.
+    // Every first occurrence precedes the others, and is never inside a
+    // duplicate, which would have had an earlier occurrence of it.
+    instruction *out = malloc(
+        size * sizeof(instruction) + (3 * size + table_size) * sizeof(size_t)
+    );
+    if (out == NULL) {
+        return SIZE_MAX;
+    }
+    size_t *ids = (size_t *)(out + size);
+    size_t *sizes = ids + size;
+    size_t *slots = sizes + size;  // Of first occurrences, or `SIZE_MAX`.
+    size_t *table = slots + size;  // Nodes plus one, zero if empty.
+    memset(table, 0, table_size * sizeof(size_t));
+
+    for (size_t i = 0; i < size; i++) {
+        const instruction *instr = &code[i];
+        uint64_t hash = (uint64_t)instr->op;
+        if (instr->op == OP_PUSH) {
+            uint64_t bits = 0;
+            memcpy(&bits, &instr->value, sizeof(bits));
+            hash = mix_hash(hash, bits);
+        } else if (instr->op == OP_VAR) {
+            hash = mix_hash(hash, instr->column);
+        }
+        size_t next = i;  // Points past the subtree of the next child.
+        for (size_t k = arity_of(instr->op); k-- > 0;) {
+            hash = mix_hash(hash, ids[next - 1]);
+            next -= sizes[next - 1];
+        }
+        sizes[i] = i + 1 - next;
+        slots[i] = SIZE_MAX;
+        ids[i] = i;
+        if (instr->op >= OP_CALL0 && instr->op <= OP_CALL5 && !instr->pure) {
+            continue;
+        }
+        size_t slot = (size_t)(hash ^ (hash >> 32)) & (table_size - 1);
+        while (table[slot] != 0 &&
+               !same_node(code, ids, sizes, table[slot] - 1, i)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] == 0) {
+            table[slot] = i + 1;
+        } else {
+            ids[i] = ids[table[slot] - 1];
+        }
+    }
+
+    // Backwards, so that only the outermost duplicates are replaced.  Their
+    // nodes are marked with `sizes` of zero, loads with `SIZE_MAX`.
+    for (size_t i = size; i-- > 0;) {
+        if (ids[i] == i || code[i].op == OP_PUSH || code[i].op == OP_VAR) {
+            continue;
+        }
+        size_t first = ids[i];
+        if (slots[first] == SIZE_MAX) {
+            slots[first] = (*slots_count)++;
+        }
+        size_t start = i + 1 - sizes[i];
+        for (size_t k = start; k < i; k++) {
+            sizes[k] = 0;
+        }
+        sizes[i] = SIZE_MAX;
+        ids[i] = slots[first];
+        i = start;
+    }
+    size_t out_size = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (sizes[i] == 0) {
+            continue;
+        }
+        if (sizes[i] == SIZE_MAX) {
+            out[out_size].op = OP_LOAD;
+            out[out_size++].column = ids[i];
+            continue;
+        }
+        out[out_size++] = code[i];
+        if (ids[i] == i && slots[i] != SIZE_MAX) {
+            out[out_size].op = OP_SAVE;
+            out[out_size++].column = slots[i];
+        }
+    }
+    memcpy(code, out, out_size * sizeof(instruction));
+    free(out);
+    return out_size;
+}
+
+// Replaces common sequences of instructions with superinstructions which
+// perform the same operations in the same order, so results do not change.
+// Returns the new size, which is never larger.
+static size_t fuse_instructions(instruction *code, size_t size) {
+    size_t out = 0;
+    for (size_t in = 0; in < size; in++) {
+        instruction instr = code[in];
+        opcode next = in + 1 < size ? code[in + 1].op : OP_END;
+        if ((instr.op == OP_PUSH || instr.op == OP_VAR) && next >= OP_ADD &&
+            next <= OP_DIV) {
+            opcode first = instr.op == OP_PUSH ? OP_ADD_CONST : OP_ADD_VAR;
+            instr.op = (opcode)(first + (next - OP_ADD));
+            in++;
+        }
+        code[out++] = instr;
+
+        // `c*x+d` and `x*c+d`, subtracting `d` is the same as adding `-d`.
+        instruction *last = &code[out - 1];
+        if (out < 3 || (last->op != OP_ADD_CONST && last->op != OP_SUB_CONST)) {
+            continue;
+        }
+        instruction *operand = &code[out - 3];
+        instruction *product = &code[out - 2];
+        double factor = 0;
+        size_t column = 0;
+        if (operand->op == OP_PUSH && product->op == OP_MUL_VAR) {
+            factor = operand->value;
+            column = product->column;
+        } else if (operand->op == OP_VAR && product->op == OP_MUL_CONST) {
+            factor = product->value;
+            column = operand->column;
+        } else {
+            continue;
+        }
+        if (isnan(factor) || isnan(last->value)) {
+            continue;  // The payload of a NaN result could change.
+        }
+        operand->column = column;
+        operand->op = OP_AFFINE;
+        product->op = OP_DATA;
+        product->value = factor;
+        if (last->op == OP_SUB_CONST) {
+            last->value = -last->value;
+        }
+        last->op = OP_DATA;
+    }
+    return out;
+}
+
+calc_error calc_evaluate(
+    const char *expr,
+    calc_result *res,
+    const calc_function *functions
+) {
+    unsigned char scratch[INTERNAL_ARENA_SIZE];
+    parser p = {
+        .expr = expr,
+        .cur = expr,
+        .functions = functions != NULL ? functions : default_functions,
+        .arena = {.data = scratch, .size = sizeof(scratch), .heap = true},
+    };
+    return evaluate(&p, res);
+}
+
+calc_error calc_evaluate_arena(
+    const char *expr,
+    calc_result *res,
+    const calc_function *functions,
+    void *arena,
+    size_t arena_size
+) {
+    parser p = {
+        .expr = expr,
+        .cur = expr,
+        .functions = functions != NULL ? functions : default_functions,
+        .arena = {.data = arena, .size = arena_size},
+    };
+    return evaluate(&p, res);
+}
+
+calc_error calc_evaluate_prepared(
+    const char *expr,
+    calc_result *res,
+    const calc_function_table *table
+) {
+    unsigned char scratch[INTERNAL_ARENA_SIZE];
+    parser p = {
+        .expr = expr,
+        .cur = expr,
+        .table = table,
+        .arena = {.data = scratch, .size = sizeof(scratch), .heap = true},
+    };
+    return evaluate(&p, res);
+}
+
+calc_error calc_compile(
+    const char *expr,
+    const calc_function *functions,
+    calc_program **program,
+    int *error_position
+) {
+    return calc_compile_columns(expr, functions, NULL, program, error_position);
+}
+
+calc_error calc_compile_columns(
+    const char *expr,
+    const calc_function *functions,
+    const char *const *variables,
+    calc_program **program,
+    int *error_position
+) {
+    unsigned char scratch[INTERNAL_ARENA_SIZE];
+    parser p = {
+        .expr = expr,
+        .cur = expr,
+        .functions = functions != NULL ? functions : default_functions,
+        .variables = variables,
+        .arena = {.data = scratch, .size = sizeof(scratch), .heap = true},
+    };
+    *program = NULL;
+    calc_error error = parse(&p);
+    size_t slots_count = 0;
+    size_t size = 0;
+    if (error == CALC_ERROR_OK) {
+        size = share_subexpressions(p.code, p.code_size, &slots_count);
+        if (size == SIZE_MAX) {
+            error = out_of_memory(&p);
+        }
+    }
+    if (error == CALC_ERROR_OK) {
+        size_t block_rows = BLOCK_STACK_SIZE / (p.max_depth + slots_count);
+        if (block_rows > MAX_BLOCK_ROWS) {
+            block_rows = MAX_BLOCK_ROWS;
+        } else if (block_rows == 0) {
+            block_rows = 1;
+        }
+        size_t variables_count = 0;
+        while (variables != NULL && variables[variables_count] != NULL) {
+            variables_count++;
+        }
+        size = fuse_instructions(p.code, size);
+        *program = malloc(
+            sizeof(calc_program) + (size + 1) * sizeof(instruction) +
+            ((p.max_depth + slots_count) * (1 + block_rows) + variables_count
+            ) * sizeof(double)
+        );
+        if (*program == NULL) {
+            error = out_of_memory(&p);
+        } else {
+            calc_program *result = *program;
+            result->size = size;
+            result->stack = (double *)(result->code + size + 1);
+            result->block_stack = result->stack + p.max_depth;
+            result->block_rows = block_rows;
+            result->nan_variables =
+                result->block_stack + p.max_depth * block_rows;
+            for (size_t i = 0; i < variables_count; i++) {
+                result->nan_variables[i] = NAN;
+            }
+            result->slots = result->nan_variables + variables_count;
+            result->block_slots = result->slots + slots_count;
+            memcpy(result->code, p.code, size * sizeof(instruction));
+            result->code[size].op = OP_END;
+            calc_set_backend(result, CALC_BACKEND_THREADED);
+        }
+    }
+    if (error != CALC_ERROR_OK && error_position != NULL) {
+        *error_position = (int)(p.error_at - p.expr);
+    }
+    free_buffer(&p.arena, p.code);
+    return error;
+}
+
+calc_backend calc_set_backend(calc_program *program, calc_backend backend) {
+#ifdef HAVE_COMPUTED_GOTO
+    program->threaded = backend == CALC_BACKEND_THREADED;
+#else
+    (void)backend;
+    program->threaded = false;
+#endif
+    return program->threaded ? CALC_BACKEND_THREADED : CALC_BACKEND_SWITCH;
+}
+
+static double run_switch(calc_program *program, const double *variables) {
+    double *top = program->stack;  // Points past the topmost operand.
+    for (const instruction *i = program->code;; i++) {
+        switch (i->op) {
+            case OP_PUSH:
+                *top++ = i->value;
+                break;
+            case OP_VAR:
+                *top++ = variables[i->column];
+                break;
+            case OP_ADD:
+                top--;
+                top[-1] += top[0];
+                break;
+            case OP_SUB:
+                top--;
+                top[-1] -= top[0];
+                break;
+            case OP_MUL:
+                top--;
+                top[-1] *= top[0];
+                break;
+            case OP_DIV:
+                top--;
+                top[-1] /= top[0];
+                break;
+            case OP_CALL0:
+                *top++ = i->func0();
+                break;
+            case OP_CALL1:
+                top[-1] = i->func1(top[-1]);
+                break;
+            case OP_CALL2:
+                top -= 1;
+                top[-1] = i->func2(top[-1], top[0]);
+                break;
+            case OP_CALL3:
+                top -= 2;
+                top[-1] = i->func3(top[-1], top[0], top[1]);
+                break;
+            case OP_CALL4:
+                top -= 3;
+                top[-1] = i->func4(top[-1], top[0], top[1], top[2]);
+                break;
+            case OP_CALL5:
+                top -= 4;
+                top[-1] = i->func5(top[-1], top[0], top[1], top[2], top[3]);
+                break;
+            case OP_SAVE:
+                program->slots[i->column] = top[-1];
+                break;
+            case OP_LOAD:
+                *top++ = program->slots[i->column];
+                break;
+            case OP_ADD_CONST:
+                top[-1] += i->value;
+                break;
+            case OP_SUB_CONST:
+                top[-1] -= i->value;
+                break;
+            case OP_MUL_CONST:
+                top[-1] *= i->value;
+                break;
+            case OP_DIV_CONST:
+                top[-1] /= i->value;
+                break;
+            case OP_ADD_VAR:
+                top[-1] += variables[i->column];
+                break;
+            case OP_SUB_VAR:
+                top[-1] -= variables[i->column];
+                break;
+            case OP_MUL_VAR:
+                top[-1] *= variables[i->column];
+                break;
+            case OP_DIV_VAR:
+                top[-1] /= variables[i->column];
+                break;
+            case OP_AFFINE:
+                *top++ = i[1].value * variables[i->column] + i[2].value;
+                i += 2;
+                break;
+            case OP_DATA:
+            case OP_END:
+                return program->stack[0];
+        }
+    }
+}
+
+#ifdef HAVE_COMPUTED_GOTO
+// Labels as values are a GNU extension.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+// The same as `run_switch`, but every instruction jumps to the next one on
+// its own instead of through the single jump of a `switch`, so the branch
+// predictor learns which instruction usually follows which.
+static double run_threaded(calc_program *program, const double *variables) {
+    static const void *const labels[] = {
+        [OP_PUSH] = &&push,          [OP_VAR] = &&var,
+        [OP_ADD] = &&add,            [OP_SUB] = &&sub,
+        [OP_MUL] = &&mul,            [OP_DIV] = &&div,
+        [OP_CALL0] = &&call0,        [OP_CALL1] = &&call1,
+        [OP_CALL2] = &&call2,        [OP_CALL3] = &&call3,
+        [OP_CALL4] = &&call4,        [OP_CALL5] = &&call5,
+        [OP_SAVE] = &&save,          [OP_LOAD] = &&load,
+        [OP_ADD_CONST] = &&add_const, [OP_SUB_CONST] = &&sub_const,
+        [OP_MUL_CONST] = &&mul_const, [OP_DIV_CONST] = &&div_const,
+        [OP_ADD_VAR] = &&add_var,    [OP_SUB_VAR] = &&sub_var,
+        [OP_MUL_VAR] = &&mul_var,    [OP_DIV_VAR] = &&div_var,
+        [OP_AFFINE] = &&affine,      [OP_DATA] = &&end,
+        [OP_END] = &&end,
+    };
+    double *top = program->stack;  // Points past the topmost operand.
+    const instruction *i = program->code;
+#define DISPATCH(length) goto *labels[(i += (length))->op]
+
+    DISPATCH(0);
+push:
+    *top++ = i->value;
+    DISPATCH(1);
+var:
+    *top++ = variables[i->column];
+    DISPATCH(1);
+add:
+    top--;
+    top[-1] += top[0];
+    DISPATCH(1);
+sub:
+    top--;
+    top[-1] -= top[0];
+    DISPATCH(1);
+mul:
+    top--;
+    top[-1] *= top[0];
+    DISPATCH(1);
+div:
+    top--;
+    top[-1] /= top[0];
+    DISPATCH(1);
+call0:
+    *top++ = i->func0();
+    DISPATCH(1);
+call1:
+    top[-1] = i->func1(top[-1]);
+    DISPATCH(1);
+call2:
+    top -= 1;
+    top[-1] = i->func2(top[-1], top[0]);
+    DISPATCH(1);
+call3:
+    top -= 2;
+    top[-1] = i->func3(top[-1], top[0], top[1]);
+    DISPATCH(1);
+call4:
+    top -= 3;
+    top[-1] = i->func4(top[-1], top[0], top[1], top[2]);
+    DISPATCH(1);
+call5:
+    top -= 4;
+    top[-1] = i->func5(top[-1], top[0], top[1], top[2], top[3]);
+    DISPATCH(1);
+save:
+    program->slots[i->column] = top[-1];
+    DISPATCH(1);
+load:
+    *top++ = program->slots[i->column];
+    DISPATCH(1);
+add_const:
+    top[-1] += i->value;
+    DISPATCH(1);
+sub_const:
+    top[-1] -= i->value;
+    DISPATCH(1);
+mul_const:
+    top[-1] *= i->value;
+    DISPATCH(1);
+div_const:
+    top[-1] /= i->value;
+    DISPATCH(1);
+add_var:
+    top[-1] += variables[i->column];
+    DISPATCH(1);
+sub_var:
+    top[-1] -= variables[i->column];
+    DISPATCH(1);
+mul_var:
+    top[-1] *= variables[i->column];
+    DISPATCH(1);
+div_var:
+    top[-1] /= variables[i->column];
+    DISPATCH(1);
+affine:
+    *top++ = i[1].value * variables[i->column] + i[2].value;
+    DISPATCH(3);
+end:
+    return program->stack[0];
+
+#undef DISPATCH
+}
+
+#pragma GCC diagnostic pop
+#endif
+
+void calc_run_variables(
+    calc_program *program,
+    const double *variables,
+    double *result
+) {
+#ifdef HAVE_COMPUTED_GOTO
+    if (program->threaded) {
+        *result = run_threaded(program, variables);
+        return;
+    }
+#endif
+    *result = run_switch(program, variables);
+}
+
+void calc_run(calc_program *program, double *result) {
+    calc_run_variables(program, program->nan_variables, result);
+}
+
+// `lhs[row] = lhs[row] <op> rhs[row]`, written as separate loops without
+// calls so that compilers vectorize them.
+static void apply_block(
+    opcode op,
+    double *restrict lhs,
+    const double *restrict rhs,
+    size_t rows
+) {
+    switch (op) {
+        case OP_ADD:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] += rhs[row];
+            }
+            break;
+        case OP_SUB:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] -= rhs[row];
+            }
+            break;
+        case OP_MUL:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] *= rhs[row];
+            }
+            break;
+        default:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] /= rhs[row];
+            }
+            break;
+    }
+}
+
+// `lhs[row] = lhs[row] <op> rhs` for the operation of `OP_ADD_CONST` and
+// others.
+static void apply_block_const(
+    opcode op,
+    double *restrict lhs,
+    double rhs,
+    size_t rows
+) {
+    switch (op) {
+        case OP_ADD_CONST:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] += rhs;
+            }
+            break;
+        case OP_SUB_CONST:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] -= rhs;
+            }
+            break;
+        case OP_MUL_CONST:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] *= rhs;
+            }
+            break;
+        default:
+            for (size_t row = 0; row < rows; row++) {
+                lhs[row] /= rhs;
+            }
+            break;
+    }
+}
+
+// Calls the function of `i` once per row with `args[k]` holding the k-th
+// arguments of the rows.  Results replace `args[0]`, which has room for them
+// even for functions without arguments.
+static void call_block(const instruction *i, double *const *args, size_t rows) {
+    switch (i->op) {
+        case OP_CALL0:
+            for (size_t row = 0; row < rows; row++) {
+                args[0][row] = i->func0();
+            }
+            break;
+        case OP_CALL1:
+            for (size_t row = 0; row < rows; row++) {
+                args[0][row] = i->func1(args[0][row]);
+            }
+            break;
+        case OP_CALL2:
+            for (size_t row = 0; row < rows; row++) {
+                args[0][row] = i->func2(args[0][row], args[1][row]);
+            }
+            break;
+        case OP_CALL3:
+            for (size_t row = 0; row < rows; row++) {
+                args[0][row] =
+                    i->func3(args[0][row], args[1][row], args[2][row]);
+            }
+            break;
+        case OP_CALL4:
+            for (size_t row = 0; row < rows; row++) {
+                args[0][row] = i->func4(
+                    args[0][row], args[1][row], args[2][row], args[3][row]
+                );
+            }
+            break;
+        default:
+            for (size_t row = 0; row < rows; row++) {
+                args[0][row] = i->func5(
+                    args[0][row], args[1][row], args[2][row], args[3][row],
+                    args[4][row]
+                );
+            }
+            break;
+    }
+}
+
+static void run_block(
+    calc_program *program,
+    size_t first_row,
+    size_t rows,
+    const double *const *inputs,
+    double *out
+) {
+    const size_t stride = program->block_rows;
+    double *top = program->block_stack;  // Points past the topmost slot.
+    const instruction *end = program->code + program->size;
+    for (const instruction *i = program->code; i != end; i++) {
+        const double *input =
+            i->op == OP_VAR || (i->op >= OP_ADD_VAR && i->op <= OP_AFFINE)
+                ? inputs[i->column] + first_row
+                : NULL;
+        switch (i->op) {
+            case OP_PUSH:
+                for (size_t row = 0; row < rows; row++) {
+                    top[row] = i->value;
+                }
+                top += stride;
+                break;
+            case OP_VAR:
+                memcpy(top, input, rows * sizeof(double));
+                top += stride;
+                break;
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+                top -= stride;
+                apply_block(i->op, top - stride, top, rows);
+                break;
+            case OP_ADD_CONST:
+            case OP_SUB_CONST:
+            case OP_MUL_CONST:
+            case OP_DIV_CONST:
+                apply_block_const(i->op, top - stride, i->value, rows);
+                break;
+            case OP_ADD_VAR:
+            case OP_SUB_VAR:
+            case OP_MUL_VAR:
+            case OP_DIV_VAR:
+                apply_block(
+                    (opcode)(OP_ADD + (i->op - OP_ADD_VAR)), top - stride,
+                    input, rows
+                );
+                break;
+            case OP_SAVE:
+                memcpy(
+                    program->block_slots + i->column * stride, top - stride,
+                    rows * sizeof(double)
+                );
+                break;
+            case OP_LOAD:
+                memcpy(
+                    top, program->block_slots + i->column * stride,
+                    rows * sizeof(double)
+                );
+                top += stride;
+                break;
+            case OP_AFFINE:
+                for (size_t row = 0; row < rows; row++) {
+                    top[row] = i[1].value * input[row] + i[2].value;
+                }
+                top += stride;
+                i += 2;
+                break;
+            default: {
+                size_t arity = (size_t)(i->op - OP_CALL0);
+                top -= arity * stride;
+                double *args[CALC_MAX_ARITY] = {top};
+                for (size_t k = 1; k < arity; k++) {
+                    args[k] = top + k * stride;
+                }
+                top += stride;
+                call_block(i, args, rows);
+                break;
+            }
+        }
+    }
+    memcpy(out + first_row, program->block_stack, rows * sizeof(double));
+}
+
+void calc_eval_columns(
+    calc_program *program,
+    size_t n_rows,
+    const double *const *inputs,
+    double *out
+) {
+    for (size_t first_row = 0; first_row < n_rows;
+         first_row += program->block_rows) {
+        size_t rows = n_rows - first_row;
+        if (rows > program->block_rows) {
+            rows = program->block_rows;
+        }
+        run_block(program, first_row, rows, inputs, out);
+    }
+}
+
+void calc_free(calc_program *program) {
+    free(program);
+}
+
+// An operation of a document with the result of its subtree.
+typedef struct node {
+    instruction instr;
+    size_t size;  // The number of nodes in the subtree, including this one.
+    double value;
+} node;
+
+struct calc_document {
+    const calc_function *functions;
+    char *text;
+    size_t length;
+    size_t text_capacity;
+    // The tree is valid only if there is no error.
+    calc_error error;
+    int error_position;
+    // In postfix order, so the children of a node are the subtrees right
+    // before it.
+    node *nodes;
+    size_t nodes_size;
+    size_t nodes_capacity;
+    // All groups of the text and one more for the whole text.
+    group *groups;
+    size_t groups_size;
+    size_t groups_capacity;
+};
+
+// Recomputes the size and the value of a node from its children.
+static void update_node(node *nodes, size_t index) {
+    node *n = &nodes[index];
+    double args[CALC_MAX_ARITY];
+    size_t next = index;  // Points past the subtree of the next child.
+    for (size_t i = arity_of(n->instr.op); i-- > 0;) {
+        args[i] = nodes[next - 1].value;
+        next -= nodes[next - 1].size;
+    }
+    n->size = index + 1 - next;
+    switch (n->instr.op) {
+        case OP_PUSH:
+            n->value = n->instr.value;
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+            n->value = apply(n->instr.op, args[0], args[1]);
+            break;
+        case OP_CALL0:
+            n->value = n->instr.func0();
+            break;
+        case OP_CALL1:
+            n->value = n->instr.func1(args[0]);
+            break;
+        case OP_CALL2:
+            n->value = n->instr.func2(args[0], args[1]);
+            break;
+        case OP_CALL3:
+            n->value = n->instr.func3(args[0], args[1], args[2]);
+            break;
+        case OP_CALL4:
+            n->value = n->instr.func4(args[0], args[1], args[2], args[3]);
+            break;
+        default:
+            n->value =
+                n->instr.func5(args[0], args[1], args[2], args[3], args[4]);
+            break;
+    }
+}
+
+// Grows a buffer of a document to at least `size` elements.
+static bool
+reserve_buffer(void **data, size_t *capacity, size_t size, size_t elem_size) {
+    arena heap = {.heap = true};
+    while (*capacity < size) {
+        void *new_data = grow_buffer(&heap, *data, capacity, elem_size);
+        if (new_data == NULL) {
+            return false;
+        }
+        *data = new_data;
+    }
+    return true;
+}
+
+// Parses `text[start, end)` and replaces with it the nodes of the group
+// `g`, which must be already removed from `groups` along with the groups
+// inside it.  `g` may be the whole text, then the document is left with the
+// parse error if there is one.  Otherwise the caller falls back to parsing
+// the whole text on errors, as an error in a group may be reported at a
+// different position when the whole text is parsed.
+static calc_error
+reparse_group(calc_document *doc, const group *g, size_t start, size_t end) {
+    unsigned char scratch[INTERNAL_ARENA_SIZE];
+    parser p = {
+        .expr = doc->text,
+        .cur = doc->text + start,
+        .end = doc->text + end,
+        .functions = doc->functions,
+        .keep_tree = true,
+        .open_group = SIZE_MAX,
+        .arena = {.data = scratch, .size = sizeof(scratch), .heap = true},
+    };
+    const size_t first = doc->nodes_size == 0
+                             ? 0
+                             : g->node + 1 - doc->nodes[g->node].size;
+    const size_t count = doc->nodes_size == 0 ? 0 : g->node + 1 - first;
+    calc_error error = parse(&p);
+    if (error == CALC_ERROR_OK &&
+        (!reserve_buffer(
+             (void **)&doc->nodes, &doc->nodes_capacity,
+             doc->nodes_size - count + p.code_size, sizeof(node)
+         ) ||
+         !reserve_buffer(
+             (void **)&doc->groups, &doc->groups_capacity,
+             doc->groups_size + p.groups_size + 1, sizeof(group)
+         ))) {
+        error = out_of_memory(&p);
+    }
+    if (error != CALC_ERROR_OK) {
+        doc->error = error;
+        doc->error_position = (int)(p.error_at - p.expr);
+        free_buffer(&p.arena, p.code);
+        free_buffer(&p.arena, p.groups);
+        return error;
+    }
+
+    // Splice the new nodes in place of the old ones.
+    const size_t size = p.code_size;
+    const size_t last = first + count - 1;
+    memmove(
+        doc->nodes + first + size, doc->nodes + first + count,
+        (doc->nodes_size - first - count) * sizeof(node)
+    );
+    doc->nodes_size = doc->nodes_size - count + size;
+    for (size_t i = 0; i < doc->groups_size; i++) {
+        if (count > 0 && doc->groups[i].node >= last) {
+            doc->groups[i].node = doc->groups[i].node - count + size;
+        }
+    }
+    for (size_t i = 0; i < p.groups_size; i++) {
+        group *new_group = &doc->groups[doc->groups_size++];
+        *new_group = p.groups[i];
+        new_group->node += first;
+    }
+    doc->groups[doc->groups_size++] =
+        (group){.start = start, .end = end, .node = first + size - 1};
+
+    // Only the new nodes and the nodes containing them need evaluation.
+    for (size_t i = 0; i < size; i++) {
+        doc->nodes[first + i].instr = p.code[i];
+        update_node(doc->nodes, first + i);
+    }
+    for (size_t i = first + size; i < doc->nodes_size; i++) {
+        size_t old_index = i - size + count;
+        if (old_index + 1 - doc->nodes[i].size <= first) {
+            update_node(doc->nodes, i);
+        }
+    }
+    free_buffer(&p.arena, p.code);
+    free_buffer(&p.arena, p.groups);
+    doc->error = CALC_ERROR_OK;
+    return CALC_ERROR_OK;
+}
+
+static calc_error reparse_all(calc_document *doc) {
+    doc->nodes_size = 0;
+    doc->groups_size = 0;
+    const group whole = {.start = 0, .end = doc->length};
+    return reparse_group(doc, &whole, 0, doc->length);
+}
+
+calc_document *
+calc_document_create(const char *expr, const calc_function *functions) {
+    calc_document *doc = calloc(1, sizeof(calc_document));
+    if (doc == NULL) {
+        return NULL;
+    }
+    doc->functions = functions != NULL ? functions : default_functions;
+    doc->error = CALC_ERROR_OUT_OF_MEMORY;
+    if (calc_document_edit(doc, 0, 0, expr, NULL) == CALC_ERROR_OUT_OF_MEMORY) {
+        calc_document_free(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+calc_error calc_document_edit(
+    calc_document *doc,
+    size_t offset,
+    size_t deleted,
+    const char *inserted,
+    calc_result *res
+) {
+    const size_t inserted_length = strlen(inserted);
+    const size_t new_length = doc->length - deleted + inserted_length;
+    if (!reserve_buffer(
+            (void **)&doc->text, &doc->text_capacity, new_length + 1, 1
+        )) {
+        return CALC_ERROR_OUT_OF_MEMORY;
+    }
+    memmove(
+        doc->text + offset + inserted_length, doc->text + offset + deleted,
+        doc->length - offset - deleted
+    );
+    memcpy(doc->text + offset, inserted, inserted_length);
+    doc->text[new_length] = '\0';
+    doc->length = new_length;
+
+    calc_error error = CALC_ERROR_OK;
+    if (doc->error != CALC_ERROR_OK) {
+        error = reparse_all(doc);
+    } else {
+        // The innermost group containing the edit, the whole text is the
+        // outermost one.  The other groups move along with the text after
+        // the edit, and those inside it are parsed anew.
+        group edited = {.start = 0, .end = SIZE_MAX};
+        size_t kept = 0;
+        for (size_t i = 0; i < doc->groups_size; i++) {
+            const group *g = &doc->groups[i];
+            if (g->start <= offset && offset + deleted <= g->end &&
+                g->end - g->start < edited.end - edited.start) {
+                edited = *g;
+            }
+        }
+        for (size_t i = 0; i < doc->groups_size; i++) {
+            group g = doc->groups[i];
+            if (g.start >= edited.start && g.end <= edited.end) {
+                continue;
+            }
+            if (g.start >= edited.end) {
+                g.start = g.start - deleted + inserted_length;
+            }
+            if (g.end >= edited.end) {
+                g.end = g.end - deleted + inserted_length;
+            }
+            doc->groups[kept++] = g;
+        }
+        doc->groups_size = kept;
+        error = reparse_group(
+            doc, &edited, edited.start,
+            edited.end - deleted + inserted_length
+        );
+        // Only the whole text starts at zero.
+        if (error != CALC_ERROR_OK && edited.start != 0) {
+            error = reparse_all(doc);
+        }
+    }
+    if (res != NULL) {
+        calc_document_result(doc, res);
+    }
+    return error;
+}
+
+calc_error calc_document_result(const calc_document *doc, calc_result *res) {
+    if (doc->error != CALC_ERROR_OK) {
+        res->error_position = doc->error_position;
+    } else {
+        res->value = doc->nodes[doc->nodes_size - 1].value;
+    }
+    return doc->error;
+}
+
+const char *calc_document_text(const calc_document *doc) {
+    return doc->text;
+}
+
+void calc_document_free(calc_document *doc) {
+    if (doc != NULL) {
+        free(doc->text);
+        free(doc->nodes);
+        free(doc->groups);
+        free(doc);
+    }
+}
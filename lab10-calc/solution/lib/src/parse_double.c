@@ -0,0 +1,503 @@
+#include "parse_double.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "pow5_table.h"
+
+// Decimal numbers are parsed into `w * 10^q` with up to 19 significant digits
+// in `w`.  Then the result is computed by the first applicable of:
+//
+// 1. Clinger's fast path: both `w` and `10^q` are exact doubles.
+// 2. The Eisel-Lemire algorithm: `w` is multiplied by a 128-bit approximation
+//    of `5^q`, which is proven to be enough for an exact `w` (Mushtak and
+//    Lemire, "Fast Number Parsing Without Fallback").
+// 3. If digits after the 19th are dropped, the results for `w` and `w + 1`
+//    usually agree.  Otherwise all digits are compared with the midpoint
+//    between the two candidates using big integers.
+
+enum {
+    MANTISSA_BITS = 52,
+    EXPONENT_BIAS = 1023,
+    INFINITE_POWER = 0x7FF,
+    MAX_W_DIGITS = 19,
+    // The midpoint between two doubles has at most 767 significant digits,
+    // so the rest only matters as "some non-zero digits".
+    MAX_DIGITS = 800,
+    BIGINT_LIMBS = 128,
+};
+
+static const int64_t MAX_EXPONENT = 1000000000000000;  // Saturated above.
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int hex_digit(char c) {
+    if (is_digit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Case-insensitive for ASCII letters in `lowercase`.
+static bool starts_with(const char *s, const char *lowercase) {
+    for (; *lowercase != '\0'; s++, lowercase++) {
+        if ((*s | 0x20) != *lowercase) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int leading_zeros(uint64_t x) {
+    int count = 0;
+    for (int shift = 32; shift > 0; shift /= 2) {
+        if (x >> (64 - shift) == 0) {
+            x <<= shift;
+            count += shift;
+        }
+    }
+    return count;
+}
+
+static double from_bits(uint64_t bits) {
+    double value = 0;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Reads an optional sign and digits after the exponent mark at `p`.  Returns
+// the end of the exponent or `p` if there are no digits.
+static const char *read_exponent(const char *p, int64_t *exponent) {
+    const char *cur = p + 1;
+    bool negative = *cur == '-';
+    if (*cur == '+' || *cur == '-') {
+        cur++;
+    }
+    if (!is_digit(*cur)) {
+        return p;
+    }
+    int64_t value = 0;
+    for (; is_digit(*cur); cur++) {
+        if (value < MAX_EXPONENT) {
+            value = value * 10 + (*cur - '0');
+        }
+    }
+    *exponent = negative ? -value : value;
+    return cur;
+}
+
+typedef struct uint128 {
+    uint64_t high;
+    uint64_t low;
+} uint128;
+
+static uint128 multiply(uint64_t a, uint64_t b) {
+    uint64_t a_low = (uint32_t)a;
+    uint64_t a_high = a >> 32;
+    uint64_t b_low = (uint32_t)b;
+    uint64_t b_high = b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t cross = (low_low >> 32) + (uint32_t)high_low + a_low * b_high;
+    uint128 result = {
+        .high = a_high * b_high + (high_low >> 32) + (cross >> 32),
+        .low = (cross << 32) | (uint32_t)low_low,
+    };
+    return result;
+}
+
+// Floor of `q * log2(10)` for |q| < 2^15.
+static int power_of_ten_exponent(int q) {
+    int product = (152170 + 65536) * q;
+    return product >= 0 ? product / 65536 : -((-product + 65535) / 65536);
+}
+
+// Bits of the double nearest to `w * 10^q`.
+static uint64_t eisel_lemire(uint64_t w, int q) {
+    const uint64_t infinity = (uint64_t)INFINITE_POWER << MANTISSA_BITS;
+    if (w == 0 || q < POW5_TABLE_MIN_Q) {
+        return 0;
+    }
+    if (q > POW5_TABLE_MAX_Q) {
+        return infinity;
+    }
+    int lz = leading_zeros(w);
+    w <<= lz;
+
+    const uint64_t *pow5 = pow5_table[q - POW5_TABLE_MIN_Q];
+    uint128 product = multiply(w, pow5[0]);
+    const uint64_t precision_mask = UINT64_MAX >> (MANTISSA_BITS + 3);
+    if ((product.high & precision_mask) == precision_mask) {
+        uint128 second = multiply(w, pow5[1]);
+        product.low += second.high;
+        if (second.high > product.low) {
+            product.high++;
+        }
+    }
+
+    int upper_bit = (int)(product.high >> 63);
+    int shift = upper_bit + 64 - MANTISSA_BITS - 3;
+    uint64_t mantissa = product.high >> shift;
+    int power2 =
+        power_of_ten_exponent(q) + 63 + upper_bit - lz + EXPONENT_BIAS;
+    if (power2 <= 0) {  // Subnormal, exact ties are impossible here.
+        if (-power2 + 1 >= 64) {
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        // Rounding up may produce the smallest normal number.
+        return mantissa;
+    }
+
+    // Ties are possible only for small `q`, then round to even.
+    if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+        (mantissa << shift) == product.high) {
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (uint64_t)2 << MANTISSA_BITS) {
+        mantissa = (uint64_t)1 << MANTISSA_BITS;
+        power2++;
+    }
+    mantissa &= ~((uint64_t)1 << MANTISSA_BITS);
+    if (power2 >= INFINITE_POWER) {
+        return infinity;
+    }
+    return mantissa | (uint64_t)power2 << MANTISSA_BITS;
+}
+
+typedef struct bigint {
+    uint32_t limbs[BIGINT_LIMBS];  // Little-endian.
+    size_t size;
+} bigint;
+
+static void bigint_multiply_add(bigint *n, uint32_t factor, uint32_t addend) {
+    uint64_t carry = addend;
+    for (size_t i = 0; i < n->size; i++) {
+        carry += (uint64_t)n->limbs[i] * factor;
+        n->limbs[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if (carry != 0 && n->size < BIGINT_LIMBS) {
+        n->limbs[n->size++] = (uint32_t)carry;
+    }
+}
+
+static void bigint_multiply_pow5(bigint *n, int64_t exponent) {
+    static const uint32_t small_pow5[] = {
+        1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625,
+        48828125, 244140625, 1220703125,
+    };
+    const int64_t max_small = 13;
+    for (; exponent > max_small; exponent -= max_small) {
+        bigint_multiply_add(n, small_pow5[max_small], 0);
+    }
+    bigint_multiply_add(n, small_pow5[exponent], 0);
+}
+
+static void bigint_shift_left(bigint *n, int64_t bits) {
+    size_t limbs = (size_t)(bits / 32);
+    int shift = (int)(bits % 32);
+    if (n->size == 0) {
+        return;
+    }
+    if (n->size + limbs + 1 > BIGINT_LIMBS) {
+        limbs = BIGINT_LIMBS - n->size - 1;  // Unreachable for valid inputs.
+    }
+    n->limbs[n->size + limbs] = 0;
+    for (size_t i = n->size; i-- > 0;) {
+        uint64_t value = (uint64_t)n->limbs[i] << shift;
+        n->limbs[i + limbs + 1] |= (uint32_t)(value >> 32);
+        n->limbs[i + limbs] = (uint32_t)value;
+    }
+    memset(n->limbs, 0, limbs * sizeof(uint32_t));
+    n->size += limbs + 1;
+    while (n->size > 0 && n->limbs[n->size - 1] == 0) {
+        n->size--;
+    }
+}
+
+static int bigint_compare(const bigint *a, const bigint *b) {
+    if (a->size != b->size) {
+        return a->size < b->size ? -1 : 1;
+    }
+    for (size_t i = a->size; i-- > 0;) {
+        if (a->limbs[i] != b->limbs[i]) {
+            return a->limbs[i] < b->limbs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void bigint_from_uint64(bigint *n, uint64_t value) {
+    n->size = 0;
+    for (; value != 0; value >>= 32) {
+        n->limbs[n->size++] = (uint32_t)value;
+    }
+}
+
+// Chooses between the double with `bits` and the next one for the decimal
+// mantissa `[begin, end)` followed by `exponent`.
+static uint64_t
+round_with_all_digits(const char *begin, const char *end, int64_t exponent,
+                      uint64_t bits) {
+    static const uint32_t pow10[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+        1000000000,
+    };
+    bigint digits = {.size = 0};
+    int chunk_size = 0;
+    uint32_t chunk = 0;
+    int64_t used = 0;
+    bool seen_point = false;
+    bool sticky = false;
+    for (const char *p = begin; p != end; p++) {
+        if (*p == '.') {
+            seen_point = true;
+            continue;
+        }
+        int digit = *p - '0';
+        if (used == 0 && digit == 0) {
+            exponent -= seen_point;
+        } else if (used < MAX_DIGITS) {
+            chunk = chunk * 10 + (uint32_t)digit;
+            used++;
+            exponent -= seen_point;
+            if (++chunk_size == 9) {
+                bigint_multiply_add(&digits, pow10[9], chunk);
+                chunk = 0;
+                chunk_size = 0;
+            }
+        } else {
+            exponent += !seen_point;
+            sticky |= digit != 0;
+        }
+    }
+    if (sticky) {  // Something between the kept digits and the next ones.
+        chunk = chunk * 10 + 1;
+        chunk_size++;
+        exponent--;
+    }
+    bigint_multiply_add(&digits, pow10[chunk_size], chunk);
+
+    // Compare with the midpoint `(2 * mantissa + 1) * 2^(power2 - 1)`.
+    uint64_t biased_power = bits >> MANTISSA_BITS;
+    uint64_t mantissa = bits & (((uint64_t)1 << MANTISSA_BITS) - 1);
+    int64_t power2 = 1 - EXPONENT_BIAS - MANTISSA_BITS;
+    if (biased_power != 0) {
+        mantissa |= (uint64_t)1 << MANTISSA_BITS;
+        power2 += (int64_t)biased_power - 1;
+    }
+    bigint midpoint = {.size = 0};
+    bigint_from_uint64(&midpoint, 2 * mantissa + 1);
+    if (exponent >= 0) {
+        bigint_multiply_pow5(&digits, exponent);
+    } else {
+        bigint_multiply_pow5(&midpoint, -exponent);
+    }
+    int64_t shift = exponent - (power2 - 1);
+    if (shift >= 0) {
+        bigint_shift_left(&digits, shift);
+    } else {
+        bigint_shift_left(&midpoint, -shift);
+    }
+    int order = bigint_compare(&digits, &midpoint);
+    return order < 0 || (order == 0 && (mantissa & 1) == 0) ? bits : bits + 1;
+}
+
+static const char *parse_decimal(const char *p, double *value) {
+    static const double exact_pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    const char *begin = p;
+    uint64_t w = 0;
+    int significant = 0;
+    int64_t exponent = 0;
+    bool truncated = false;
+    bool seen_point = false;
+    bool seen_digit = false;
+    for (;; p++) {
+        if (*p == '.' && !seen_point) {
+            seen_point = true;
+            continue;
+        }
+        if (!is_digit(*p)) {
+            break;
+        }
+        seen_digit = true;
+        int digit = *p - '0';
+        if (significant == 0 && digit == 0) {
+            exponent -= seen_point;
+        } else if (significant < MAX_W_DIGITS) {
+            w = w * 10 + (uint64_t)digit;
+            significant++;
+            exponent -= seen_point;
+        } else {
+            exponent += !seen_point;
+            truncated |= digit != 0;
+        }
+    }
+    if (!seen_digit) {
+        return NULL;
+    }
+    const char *mantissa_end = p;
+    int64_t explicit_exponent = 0;
+    if (*p == 'e' || *p == 'E') {
+        p = read_exponent(p, &explicit_exponent);
+    }
+    exponent += explicit_exponent;
+
+#if FLT_EVAL_METHOD == 0
+    if (!truncated && exponent >= -22 && exponent <= 22 &&
+        w <= (uint64_t)1 << (MANTISSA_BITS + 1)) {
+        *value = exponent >= 0 ? (double)w * exact_pow10[exponent]
+                               : (double)w / exact_pow10[-exponent];
+        return p;
+    }
+#else
+    (void)exact_pow10;
+#endif
+
+    int q = (int)(exponent < -1000 ? -1000 : exponent > 1000 ? 1000 : exponent);
+    uint64_t bits = eisel_lemire(w, q);
+    if (truncated && bits != eisel_lemire(w + 1, q)) {
+        bits = round_with_all_digits(
+            begin, mantissa_end, explicit_exponent, bits
+        );
+    }
+    *value = from_bits(bits);
+    return p;
+}
+
+// Rounds `(mantissa + sticky) * 2^exponent` to the nearest double, where
+// `sticky` is a non-zero value below one if `has_sticky`.
+static double
+round_binary(uint64_t mantissa, int64_t exponent, bool has_sticky) {
+    if (mantissa == 0) {
+        return 0;
+    }
+    int lz = leading_zeros(mantissa);
+    mantissa <<= lz;
+    exponent -= lz;
+    int64_t top = exponent + 63;  // The exponent of the highest bit.
+    if (top >= EXPONENT_BIAS + 1) {
+        return HUGE_VAL;
+    }
+    int64_t dropped = 63 - MANTISSA_BITS;
+    if (top < 1 - EXPONENT_BIAS) {
+        dropped += 1 - EXPONENT_BIAS - top;
+    }
+    if (dropped > 64) {
+        return 0;
+    }
+    uint64_t kept = dropped == 64 ? 0 : mantissa >> dropped;
+    uint64_t rest = dropped == 64 ? mantissa : mantissa << (64 - dropped);
+    const uint64_t half = (uint64_t)1 << 63;
+    if (rest > half || (rest == half && (has_sticky || (kept & 1) != 0))) {
+        kept++;
+    }
+    return ldexp((double)kept, (int)(exponent + dropped));
+}
+
+// `p` points after `0x`.
+static const char *parse_hex(const char *p, double *value) {
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int64_t exponent = 0;
+    bool sticky = false;
+    bool seen_point = false;
+    bool seen_digit = false;
+    for (;; p++) {
+        if (*p == '.' && !seen_point) {
+            seen_point = true;
+            continue;
+        }
+        int digit = hex_digit(*p);
+        if (digit < 0) {
+            break;
+        }
+        seen_digit = true;
+        if (significant == 0 && digit == 0) {
+            exponent -= 4 * seen_point;
+        } else if (significant < 16) {
+            mantissa = mantissa << 4 | (uint64_t)digit;
+            significant++;
+            exponent -= 4 * seen_point;
+        } else {
+            exponent += 4 * !seen_point;
+            sticky |= digit != 0;
+        }
+    }
+    if (!seen_digit) {
+        return NULL;
+    }
+    if (*p == 'p' || *p == 'P') {
+        int64_t explicit_exponent = 0;
+        p = read_exponent(p, &explicit_exponent);
+        exponent += explicit_exponent;
+    }
+    *value = round_binary(mantissa, exponent, sticky);
+    return p;
+}
+
+static const char *parse_special(const char *p, double *value) {
+    if (starts_with(p, "inf")) {
+        *value = INFINITY;
+        return p + (starts_with(p + 3, "inity") ? 8 : 3);
+    }
+    if (starts_with(p, "nan")) {
+        *value = NAN;
+        p += 3;
+        if (*p == '(') {
+            const char *end = p + 1;
+            while (is_digit(*end) || *end == '_' ||
+                   (unsigned)((*end | 0x20) - 'a') < 26) {
+                end++;
+            }
+            if (*end == ')') {
+                p = end + 1;
+            }
+        }
+        return p;
+    }
+    return NULL;
+}
+
+const char *calc_parse_double(const char *s, double *value) {
+    const char *p = s;
+    bool negative = *p == '-';
+    if (*p == '+' || *p == '-') {
+        p++;
+    }
+    double magnitude = 0;
+    const char *end = NULL;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        end = parse_hex(p + 2, &magnitude);
+        if (end == NULL) {  // Just `0` followed by `x`.
+            end = p + 1;
+        }
+    } else if (is_digit(*p) || *p == '.') {
+        end = parse_decimal(p, &magnitude);
+    } else {
+        end = parse_special(p, &magnitude);
+    }
+    if (end == NULL) {
+        return s;
+    }
+    *value = negative ? -magnitude : magnitude;
+    return end;
+}
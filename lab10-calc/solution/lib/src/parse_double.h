@@ -0,0 +1,11 @@
+#ifndef PARSE_DOUBLE_H_
+#define PARSE_DOUBLE_H_
+
+// Parses the longest prefix of `s` which `strtod` parses in the "C" locale,
+// not counting leading whitespace: decimal and hexadecimal numbers with
+// optional exponents, `inf`, `infinity` and `nan` with an optional payload in
+// parentheses.  The result is correctly rounded.  Returns the end of the
+// number or `s` if there is none.
+const char *calc_parse_double(const char *s, double *value);
+
+#endif  // PARSE_DOUBLE_H_
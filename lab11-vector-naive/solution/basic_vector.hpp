@@ -0,0 +1,646 @@
+#ifndef BASIC_VECTOR_HPP_
+#define BASIC_VECTOR_HPP_
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "trivially_relocatable.hpp"
+#include "vector_config.hpp"
+#include "vector_growth.hpp"
+
+namespace lab_vector_naive {
+// An allocator with `reallocate(p, old_capacity, new_capacity)`, which moves
+// the bytes of elements to a larger buffer like `std::realloc`.
+template <typename Alloc, typename T>
+concept reallocating_allocator =
+    requires(Alloc &alloc, T *p, std::size_t n) {
+        { alloc.reallocate(p, n, n) } -> std::same_as<T *>;
+    };
+
+// An allocator with `extend(p, old_capacity, new_capacity)`, which tries to
+// enlarge the buffer at `p` without moving it and returns whether it did.
+// Vectors try it first when they grow, so any elements keep their addresses.
+template <typename Alloc, typename T>
+concept extending_allocator = requires(Alloc &alloc, T *p, std::size_t n) {
+    { alloc.extend(p, n, n) } -> std::same_as<bool>;
+};
+
+namespace detail {
+// Space for `N` elements inside the vector object itself.
+template <typename T, std::size_t N>
+struct inline_storage {
+    // NOLINTNEXTLINE(modernize-use-equals-default): elements come later.
+    inline_storage() VECTOR_NOEXCEPT {
+    }
+
+    T *data() VECTOR_NOEXCEPT {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return reinterpret_cast<T *>(m_bytes);
+    }
+
+private:
+    alignas(T) std::byte m_bytes[N * sizeof(T)];
+};
+
+template <typename T>
+struct inline_storage<T, 0> {
+    T *data() VECTOR_NOEXCEPT {
+        return nullptr;
+    }
+};
+}  // namespace detail
+
+// Keeps up to `InlineCapacity` elements inside the object and moves them to a
+// buffer from `Alloc` when there are more.  `Growth` chooses the capacity of
+// the buffer, see `growth`.  Use `vector` (no inline elements) or
+// `small_vector` instead of this.
+template <
+    typename T,
+    std::size_t InlineCapacity,
+    typename Alloc,
+    typename Growth = growth::power_of_two>
+class basic_vector {
+    using traits = std::allocator_traits<Alloc>;
+    static_assert(
+        std::is_same_v<typename traits::pointer, T *>,
+        "fancy pointers are not supported"
+    );
+
+    // Grows with `m_alloc.reallocate()` instead of moving the elements.
+    static constexpr bool reallocates =
+        is_trivially_relocatable_v<T> && reallocating_allocator<Alloc, T>;
+
+    static constexpr bool takes_buffers =
+        traits::propagate_on_container_move_assignment::value ||
+        traits::is_always_equal::value;
+
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+
+    basic_vector() = default;
+
+    explicit basic_vector(const Alloc &alloc) VECTOR_NOEXCEPT : m_alloc(alloc) {
+    }
+
+    explicit basic_vector(std::size_t n, const Alloc &alloc = Alloc())
+        : m_alloc(alloc) {
+        append_with(n, [this](T *first, std::size_t count) {
+            construct_each(first, count, [this](T *p) { construct(p); });
+        });
+    }
+
+    basic_vector(std::size_t n, const T &value, const Alloc &alloc = Alloc())
+        : m_alloc(alloc) {
+        append_with(n, copies_of(value));
+    }
+
+    basic_vector(std::size_t n, T &&value, const Alloc &alloc = Alloc())
+        : m_alloc(alloc) {
+        append_with(n, copies_of(std::move(value)));
+    }
+
+    basic_vector(const basic_vector &other)
+        : basic_vector(
+              other,
+              traits::select_on_container_copy_construction(other.m_alloc)
+          ) {
+    }
+
+    basic_vector(const basic_vector &other, const Alloc &alloc)
+        : m_alloc(alloc) {
+        append_with(other.m_size, [this, &other](T *first, std::size_t count) {
+            construct_each(first, count, [&](T *p) {
+                construct(p, other.m_data[p - first]);
+            });
+        });
+    }
+
+    basic_vector(basic_vector &&other) VECTOR_NOEXCEPT
+        : m_alloc(std::move(other.m_alloc)) {
+        take_elements(other);
+    }
+
+    // Moves the elements one by one if `alloc` cannot free the buffer of
+    // `other`.
+    basic_vector(basic_vector &&other, const Alloc &alloc) : m_alloc(alloc) {
+        if (shares_allocator(other)) {
+            take_elements(other);
+            return;
+        }
+        append_with(other.m_size, [this, &other](T *first, std::size_t count) {
+            construct_each(first, count, [&](T *p) {
+                construct(p, std::move(other.m_data[p - first]));
+            });
+        });
+        other.clear();
+    }
+
+    basic_vector &operator=(const basic_vector &other) {
+        if (this == &other) {
+            return *this;
+        }
+        if constexpr (traits::propagate_on_container_copy_assignment::value) {
+            if (!shares_allocator(other)) {
+                basic_vector copy(other, other.m_alloc);
+                clear();
+                free_buffer();
+                m_alloc = other.m_alloc;
+                take_elements(copy);
+                return *this;
+            }
+            m_alloc = other.m_alloc;
+        }
+        if (other.m_size > m_capacity) {
+            // Copies before touching anything for the strong guarantee.
+            return *this = basic_vector(other, m_alloc);
+        }
+        const std::size_t common = std::min(m_size, other.m_size);
+        for (std::size_t i = 0; i < common; i++) {
+            m_data[i] = other.m_data[i];
+        }
+        if (m_size > other.m_size) {
+            destroy_each(m_data + other.m_size, m_size - other.m_size);
+        } else {
+            construct_each(
+                m_data + m_size, other.m_size - m_size,
+                [&](T *p) { construct(p, other.m_data[p - m_data]); }
+            );
+        }
+        m_size = other.m_size;
+        return *this;
+    }
+
+    // Cannot throw when the buffer of `other` can always be taken.
+    basic_vector &operator=(basic_vector &&other) VECTOR_NOEXCEPT
+        requires(takes_buffers)
+    {
+        return move_from(other);
+    }
+
+    basic_vector &operator=(basic_vector &&other)
+        requires(!takes_buffers)
+    {
+        return move_from(other);
+    }
+
+    ~basic_vector() {
+        clear();
+        deallocate();
+    }
+
+    // Allocators are swapped only if they propagate on swap, otherwise they
+    // must be equal.
+    void swap(basic_vector &other) VECTOR_NOEXCEPT {
+        if constexpr (InlineCapacity == 0) {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_capacity, other.m_capacity);
+            if constexpr (traits::propagate_on_container_swap::value) {
+                using std::swap;
+                swap(m_alloc, other.m_alloc);
+            }
+        } else {
+            basic_vector tmp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(tmp);
+        }
+    }
+
+    friend void swap(basic_vector &a, basic_vector &b) VECTOR_NOEXCEPT {
+        a.swap(b);
+    }
+
+    [[nodiscard]] Alloc get_allocator() const VECTOR_NOEXCEPT {
+        return m_alloc;
+    }
+
+    [[nodiscard]] bool empty() const VECTOR_NOEXCEPT {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] std::size_t size() const VECTOR_NOEXCEPT {
+        return m_size;
+    }
+
+    [[nodiscard]] std::size_t capacity() const VECTOR_NOEXCEPT {
+        return m_capacity;
+    }
+
+    [[nodiscard]] T &operator[](std::size_t index) & VECTOR_NOEXCEPT {
+        return m_data[index];
+    }
+
+    [[nodiscard]] T &&operator[](std::size_t index) && VECTOR_NOEXCEPT {
+        return std::move(m_data[index]);
+    }
+
+    [[nodiscard]] const T &operator[](std::size_t index
+    ) const & VECTOR_NOEXCEPT {
+        return m_data[index];
+    }
+
+    [[nodiscard]] T &at(std::size_t index) & {
+        check_index(index);
+        return m_data[index];
+    }
+
+    [[nodiscard]] T &&at(std::size_t index) && {
+        check_index(index);
+        return std::move(m_data[index]);
+    }
+
+    [[nodiscard]] const T &at(std::size_t index) const & {
+        check_index(index);
+        return m_data[index];
+    }
+
+    void reserve(std::size_t n) {
+        if (n > m_capacity) {
+            const std::size_t capacity = Growth::next_capacity(0, n, sizeof(T));
+            if (!extend(capacity)) {
+                reallocate(capacity);
+            }
+        }
+    }
+
+    void push_back(const T &value) {
+        emplace_back(value);
+    }
+
+    void push_back(T &&value) {
+        emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    T &emplace_back(Args &&...args) {
+        append_with(
+            1,
+            [&](T *first, std::size_t) {
+                construct(first, std::forward<Args>(args)...);
+            },
+            (points_into(std::addressof(args)) || ...) ||
+                !std::is_nothrow_constructible_v<T, Args &&...>
+        );
+        return m_data[m_size - 1];
+    }
+
+    // Appends `count` elements constructed from the same `args`.
+    template <typename... Args>
+    void emplace_back_n(std::size_t count, const Args &...args) {
+        append_with(
+            count,
+            [&](T *first, std::size_t n) {
+                construct_each(first, n, [&](T *p) { construct(p, args...); });
+            },
+            (points_into(std::addressof(args)) || ...) ||
+                !std::is_nothrow_constructible_v<T, const Args &...>
+        );
+    }
+
+    // Reserves space once and copies contiguous trivially copyable elements
+    // with `memcpy`.  Only contiguous ranges are known not to refer to the
+    // elements and not to throw while iterated, others are read before the
+    // elements move.
+    template <typename R>
+        requires(std::ranges::forward_range<R> ||
+                 std::ranges::sized_range<R>) &&
+                std::constructible_from<T, std::ranges::range_reference_t<R>>
+    void append_range(R &&range) {
+        std::size_t count = 0;
+        if constexpr (std::ranges::sized_range<R>) {
+            count = static_cast<std::size_t>(std::ranges::size(range));
+        } else {
+            count = static_cast<std::size_t>(std::ranges::distance(range));
+        }
+        bool construct_first = true;
+        if constexpr (std::ranges::contiguous_range<R> &&
+                      std::is_nothrow_constructible_v<
+                          T, std::ranges::range_reference_t<R>>) {
+            construct_first = points_into(std::ranges::data(range));
+        }
+        append_with(
+            count,
+            [&](T *first, std::size_t n) {
+                if constexpr (std::ranges::contiguous_range<R> &&
+                              std::same_as<std::ranges::range_value_t<R>, T> &&
+                              std::is_trivially_copyable_v<T>) {
+                    const T *source = std::ranges::data(range);
+                    if (n != 0) {
+                        std::memcpy(
+                            static_cast<void *>(first),
+                            static_cast<const void *>(source), n * sizeof(T)
+                        );
+                    }
+                } else {
+                    auto it = std::ranges::begin(range);
+                    construct_each(first, n, [&](T *p) {
+                        construct(p, *it);
+                        ++it;
+                    });
+                }
+            },
+            construct_first
+        );
+    }
+
+    void pop_back() VECTOR_NOEXCEPT {
+        m_size--;
+        traits::destroy(m_alloc, m_data + m_size);
+    }
+
+    void clear() VECTOR_NOEXCEPT {
+        destroy_each(m_data, m_size);
+        m_size = 0;
+    }
+
+    void resize(std::size_t n) {
+        resize_with(
+            n,
+            [this](T *first, std::size_t count) {
+                construct_each(first, count, [this](T *p) { construct(p); });
+            },
+            !std::is_nothrow_default_constructible_v<T>
+        );
+    }
+
+    void resize(std::size_t n, const T &value) {
+        resize_with(n, copies_of(value), points_into(std::addressof(value)));
+    }
+
+    void resize(std::size_t n, T &&value) {
+        const bool reads_elements = points_into(std::addressof(value));
+        resize_with(n, copies_of(std::move(value)), reads_elements);
+    }
+
+    // Leaves new elements uninitialized to be overwritten, e.g. by `read()`.
+    void resize_for_overwrite(std::size_t n)
+        requires std::is_trivially_default_constructible_v<T>
+    {
+        resize_with(n, [this](T *first, std::size_t count) {
+            construct_each(first, count, [](T *p) {
+                ::new (static_cast<void *>(p)) T;
+            });
+        });
+    }
+
+private:
+    [[nodiscard]] bool on_heap() const VECTOR_NOEXCEPT {
+        return m_capacity > InlineCapacity;
+    }
+
+    [[nodiscard]] bool shares_allocator(const basic_vector &other
+    ) const VECTOR_NOEXCEPT {
+        if constexpr (traits::is_always_equal::value) {
+            return true;
+        } else {
+            return m_alloc == other.m_alloc;
+        }
+    }
+
+    // Only tells whether arguments may be invalidated by `reallocate()`.
+    [[nodiscard]] bool points_into(const void *p) const VECTOR_NOEXCEPT {
+        if constexpr (reallocates) {
+            const std::less<const void *> less;
+            return !less(p, m_data) && less(p, m_data + m_size);
+        } else {
+            return false;
+        }
+    }
+
+    void check_index(std::size_t index) const {
+        if (index >= m_size) {
+            throw std::out_of_range("vector index out of range");
+        }
+    }
+
+    template <typename... Args>
+    void construct(T *p, Args &&...args) {
+        traits::construct(m_alloc, p, std::forward<Args>(args)...);
+    }
+
+    // Destroys the constructed elements if `f` throws.
+    template <typename Construct>
+    void construct_each(T *first, std::size_t count, Construct f) {
+        T *p = first;
+        try {
+            for (; p != first + count; ++p) {
+                f(p);
+            }
+        } catch (...) {
+            destroy_each(first, static_cast<std::size_t>(p - first));
+            throw;
+        }
+    }
+
+    void destroy_each(T *first, std::size_t count) VECTOR_NOEXCEPT {
+        for (T *p = first; p != first + count; ++p) {
+            traits::destroy(m_alloc, p);
+        }
+    }
+
+    // Moves elements to uninitialized `to` and destroys the originals.
+    void relocate(T *from, std::size_t count, T *to) VECTOR_NOEXCEPT {
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if (count != 0) {
+                std::memcpy(
+                    static_cast<void *>(to), static_cast<void *>(from),
+                    count * sizeof(T)
+                );
+            }
+        } else {
+            for (std::size_t i = 0; i < count; i++) {
+                construct(to + i, std::move(from[i]));
+                traits::destroy(m_alloc, from + i);
+            }
+        }
+    }
+
+    // Copies `value` to all new elements but the last one, which gets the
+    // value itself if it is an rvalue.
+    template <typename Value>
+    auto copies_of(Value &&value) {
+        return [this, &v = value](T *first, std::size_t count) {
+            construct_each(first, count, [&](T *p) {
+                if (p == first + count - 1) {
+                    construct(p, std::forward<Value>(v));
+                } else {
+                    construct(p, std::as_const(v));
+                }
+            });
+        };
+    }
+
+    // Allocates at least `capacity` elements and stores the actual number.
+    T *allocate(std::size_t &capacity) {
+#if defined(__cpp_lib_allocate_at_least) && \
+    __cpp_lib_allocate_at_least >= 202302L
+        const auto result = traits::allocate_at_least(m_alloc, capacity);
+        capacity = result.count;
+        return result.ptr;
+#else
+        return traits::allocate(m_alloc, capacity);
+#endif
+    }
+
+    void deallocate() VECTOR_NOEXCEPT {
+        if (on_heap()) {
+            traits::deallocate(m_alloc, m_data, m_capacity);
+        }
+    }
+
+    // Frees the buffer of a vector without elements.
+    void free_buffer() VECTOR_NOEXCEPT {
+        deallocate();
+        m_data = m_inline.data();
+        m_capacity = InlineCapacity;
+    }
+
+    // Moves the elements to a new buffer of `capacity` elements at `data`.
+    void replace_buffer(T *data, std::size_t capacity) VECTOR_NOEXCEPT {
+        relocate(m_data, m_size, data);
+        deallocate();
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    // Tries to enlarge the buffer to `capacity` elements without moving it.
+    bool extend(std::size_t capacity) {
+        if constexpr (extending_allocator<Alloc, T>) {
+            if (on_heap() && m_alloc.extend(m_data, m_capacity, capacity)) {
+                m_capacity = capacity;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the elements to a buffer of at least `capacity` elements.
+    void reallocate(std::size_t capacity) {
+        if constexpr (reallocates) {
+            if (on_heap()) {
+                m_data = m_alloc.reallocate(m_data, m_capacity, capacity);
+                m_capacity = capacity;
+                return;
+            }
+        }
+        T *data = allocate(capacity);
+        replace_buffer(data, capacity);
+    }
+
+    // Appends `count` elements created by `construct(first, count)`, which
+    // destroys its elements if it throws.  When the buffer cannot be extended
+    // and is replaced, they are created before the old elements are moved, so
+    // arguments may refer to the old elements and nothing changes on throw.
+    // With `reallocates` the elements move first unless `construct_first`,
+    // which is required if creating them reads the elements or may throw.
+    template <typename Construct>
+    void append_with(
+        std::size_t count,
+        Construct construct,
+        bool construct_first = false
+    ) {
+        const std::size_t size = m_size + count;
+        if (size > m_capacity) {
+            std::size_t capacity =
+                Growth::next_capacity(m_capacity, size, sizeof(T));
+            if (!extend(capacity)) {
+                if (!reallocates || !on_heap() || construct_first) {
+                    T *data = allocate(capacity);
+                    try {
+                        construct(data + m_size, count);
+                    } catch (...) {
+                        traits::deallocate(m_alloc, data, capacity);
+                        throw;
+                    }
+                    replace_buffer(data, capacity);
+                    m_size = size;
+                    return;
+                }
+                reallocate(capacity);
+            }
+        }
+        construct(m_data + m_size, count);
+        m_size = size;
+    }
+
+    template <typename Construct>
+    void resize_with(
+        std::size_t n,
+        Construct construct,
+        bool construct_first = false
+    ) {
+        if (n < m_size) {
+            destroy_each(m_data + n, m_size - n);
+            m_size = n;
+        } else {
+            append_with(n - m_size, construct, construct_first);
+        }
+    }
+
+    // Moves the elements one by one if the allocators differ and do not
+    // propagate.
+    basic_vector &move_from(basic_vector &other) {
+        if (this == &other) {
+            return *this;
+        }
+        if constexpr (!traits::propagate_on_container_move_assignment::value) {
+            if (!shares_allocator(other)) {
+                return *this = basic_vector(std::move(other), m_alloc);
+            }
+        }
+        clear();
+        if constexpr (traits::propagate_on_container_move_assignment::value) {
+            if (!shares_allocator(other)) {
+                free_buffer();
+            }
+            m_alloc = std::move(other.m_alloc);
+        }
+        take_elements(other);
+        return *this;
+    }
+
+    // Takes the elements of `other` when `*this` is empty, and leaves
+    // `other` empty.  Heap buffers are swapped instead of being freed, so
+    // the allocators must be equal.
+    void take_elements(basic_vector &other) VECTOR_NOEXCEPT {
+        if (other.on_heap()) {
+            if (on_heap()) {
+                std::swap(m_data, other.m_data);
+                std::swap(m_capacity, other.m_capacity);
+            } else {
+                m_data = other.m_data;
+                m_capacity = other.m_capacity;
+                other.m_data = other.m_inline.data();
+                other.m_capacity = InlineCapacity;
+            }
+        } else {
+            relocate(other.m_data, other.m_size, m_data);
+        }
+        m_size = other.m_size;
+        other.m_size = 0;
+    }
+
+    [[no_unique_address]] Alloc m_alloc{};
+    [[no_unique_address]] detail::inline_storage<T, InlineCapacity> m_inline;
+    T *m_data = m_inline.data();
+    std::size_t m_size = 0;
+    std::size_t m_capacity = InlineCapacity;
+};
+
+// Buffers of vectors without inline elements only need the allocator to move.
+template <typename T, typename Alloc, typename Growth>
+struct is_trivially_relocatable<basic_vector<T, 0, Alloc, Growth>>
+    : std::is_empty<Alloc> {};
+}  // namespace lab_vector_naive
+
+#endif  // BASIC_VECTOR_HPP_
@@ -0,0 +1,54 @@
+#ifndef MALLOC_ALLOCATOR_HPP_
+#define MALLOC_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "vector_config.hpp"
+
+namespace lab_vector_naive {
+// Takes memory from `std::malloc`, so vectors of trivially relocatable
+// elements grow with `std::realloc`.  It extends a buffer in place when the
+// memory after it is free, and glibc moves large buffers with `mremap`, so
+// the old and the new buffer are never resident at once and the elements
+// are not copied.
+template <typename T>
+struct malloc_allocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+
+    using value_type = T;
+
+    malloc_allocator() = default;
+
+    template <typename U>
+    explicit malloc_allocator(const malloc_allocator<U> &) VECTOR_NOEXCEPT {
+    }
+
+    T *allocate(std::size_t n) {
+        return reallocate(nullptr, 0, n);
+    }
+
+    T *reallocate(T *p, std::size_t, std::size_t n) {
+        if (n > std::size_t(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void *result = std::realloc(p, n * sizeof(T));
+        if (result == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(result);
+    }
+
+    void deallocate(T *p, std::size_t) VECTOR_NOEXCEPT {
+        std::free(p);
+    }
+
+    friend bool
+    operator==(const malloc_allocator &, const malloc_allocator &)
+        VECTOR_NOEXCEPT {
+        return true;
+    }
+};
+}  // namespace lab_vector_naive
+
+#endif  // MALLOC_ALLOCATOR_HPP_
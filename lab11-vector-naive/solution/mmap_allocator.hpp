@@ -0,0 +1,168 @@
+#ifndef MMAP_ALLOCATOR_HPP_
+#define MMAP_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "vector_config.hpp"
+
+namespace lab_vector_naive {
+// Reserves a large range of address space for each buffer and commits pages
+// only as the buffer is extended, so a `vector` with this allocator never
+// copies its elements and keeps their addresses while it fits into the range.
+// A larger vector moves to a new range.  The range costs no memory until it
+// is committed, and committed pages take memory only when touched.  Needs a
+// 64-bit address space for the default of 64 GiB per buffer.
+template <typename T>
+class mmap_allocator {
+public:
+    using value_type = T;
+    // Vectors take buffers with the allocator on move-assignment and swap.
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    static constexpr std::size_t default_reserved_bytes = std::size_t(64) << 30;
+
+    mmap_allocator() = default;
+
+    // `huge_pages` asks Linux to back the range with transparent huge pages,
+    // which cuts page faults and TLB misses by 512 times but commits memory
+    // in 2 MiB steps.
+    explicit mmap_allocator(
+        std::size_t reserved_bytes,
+        bool huge_pages = false
+    ) VECTOR_NOEXCEPT : m_reserved_bytes(reserved_bytes),
+                        m_huge_pages(huge_pages) {
+    }
+
+    template <typename U>
+    explicit mmap_allocator(const mmap_allocator<U> &other) VECTOR_NOEXCEPT
+        : m_reserved_bytes(other.reserved_bytes()),
+          m_huge_pages(other.huge_pages()) {
+    }
+
+    [[nodiscard]] std::size_t reserved_bytes() const VECTOR_NOEXCEPT {
+        return m_reserved_bytes;
+    }
+
+    [[nodiscard]] bool huge_pages() const VECTOR_NOEXCEPT {
+        return m_huge_pages;
+    }
+
+    T *allocate(std::size_t n) {
+        if (n > std::size_t(-1) / 2 / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        const std::size_t reserved = reservation(n);
+        // Huge pages need a range aligned to their size, so the unaligned
+        // ends of a larger range are unmapped.
+        const std::size_t alignment = m_huge_pages ? huge_page_size : 0;
+        void *mapped = mmap(
+            nullptr, reserved + alignment, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+        );
+        if (mapped == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        auto *p = static_cast<std::byte *>(mapped);
+        if (m_huge_pages) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            const auto address = reinterpret_cast<std::uintptr_t>(p);
+            const std::size_t head =
+                (huge_page_size - address % huge_page_size) % huge_page_size;
+            if (head != 0) {
+                munmap(p, head);
+            }
+            munmap(p + head + reserved, alignment - head);
+            p += head;
+#ifdef MADV_HUGEPAGE
+            madvise(p, reserved, MADV_HUGEPAGE);  // Only a hint.
+#endif
+        }
+        if (!commit(p, reserved, 0, n)) {
+            munmap(p, reserved);
+            throw std::bad_alloc();
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return reinterpret_cast<T *>(p);
+    }
+
+    // Returns `false` if `n` elements do not fit into the range.
+    bool extend(T *p, std::size_t old_n, std::size_t n) {
+        const std::size_t reserved = reservation(old_n);
+        if (n > std::size_t(-1) / 2 / sizeof(T) ||
+            page_round(n * sizeof(T)) > reserved) {
+            return false;
+        }
+        if (!commit(p, reserved, old_n, n)) {
+            throw std::bad_alloc();
+        }
+        return true;
+    }
+
+    void deallocate(T *p, std::size_t n) VECTOR_NOEXCEPT {
+        munmap(p, reservation(n));
+    }
+
+    // Buffers are committed in huge pages or not, so allocators differing
+    // in that cannot extend buffers of each other.
+    friend bool
+    operator==(const mmap_allocator &a, const mmap_allocator &b)
+        VECTOR_NOEXCEPT {
+        return a.m_reserved_bytes == b.m_reserved_bytes &&
+               a.m_huge_pages == b.m_huge_pages;
+    }
+
+private:
+    static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+    static std::size_t page_round(std::size_t bytes) VECTOR_NOEXCEPT {
+        static const auto page_size =
+            static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        return (bytes + page_size - 1) / page_size * page_size;
+    }
+
+    // Depends only on the capacity, which grows only within the range.
+    [[nodiscard]] std::size_t reservation(std::size_t n
+    ) const VECTOR_NOEXCEPT {
+        const std::size_t bytes = page_round(n * sizeof(T));
+        return bytes > m_reserved_bytes ? bytes : page_round(m_reserved_bytes);
+    }
+
+    // Makes pages for elements `[old_n, n)` of the range writable, whole huge
+    // pages if they are used.  Fails if the system is out of memory to commit.
+    bool commit(
+        void *p,
+        std::size_t reserved,
+        std::size_t old_n,
+        std::size_t n
+    ) const VECTOR_NOEXCEPT {
+        const std::size_t from = commit_round(old_n * sizeof(T), reserved);
+        const std::size_t to = commit_round(n * sizeof(T), reserved);
+        return from >= to ||
+               mprotect(
+                   static_cast<std::byte *>(p) + from, to - from,
+                   PROT_READ | PROT_WRITE
+               ) == 0;
+    }
+
+    [[nodiscard]] std::size_t
+    commit_round(std::size_t bytes, std::size_t reserved) const
+        VECTOR_NOEXCEPT {
+        if (!m_huge_pages || bytes == 0) {
+            return page_round(bytes);
+        }
+        const std::size_t rounded =
+            (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+        return rounded < reserved ? rounded : reserved;
+    }
+
+    std::size_t m_reserved_bytes = default_reserved_bytes;
+    bool m_huge_pages = false;
+};
+}  // namespace lab_vector_naive
+
+#endif  // MMAP_ALLOCATOR_HPP_
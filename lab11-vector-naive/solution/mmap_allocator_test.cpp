@@ -0,0 +1,74 @@
+#include "mmap_allocator.hpp"
+#include <cstddef>
+#include <string>
+#include <utility>
+#include "doctest.h"
+#include "vector.hpp"
+
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+// NOLINTBEGIN(misc-use-anonymous-namespace)
+
+using lab_vector_naive::mmap_allocator;
+
+TEST_CASE("mmap_allocator keeps elements in place") {
+    lab_vector_naive::vector<std::string, mmap_allocator<std::string>> v;
+    v.push_back("first");
+    const std::string *first = &v[0];
+    for (int i = 1; i < 100'000; i++) {
+        v.push_back(v[i - 1]);
+    }
+    v.reserve(1'000'000);
+    CHECK(&v[0] == first);
+    CHECK(v.size() == 100'000);
+    CHECK(v.capacity() == 1 << 20);
+    CHECK(v[99'999] == "first");
+
+    const auto copy = v;
+    CHECK(copy[99'999] == "first");
+    v = std::move(copy);
+    CHECK(v[99'999] == "first");
+}
+
+TEST_CASE("mmap_allocator moves elements beyond the reserved range") {
+    for (const bool huge_pages : {false, true}) {
+        const mmap_allocator<int> alloc(1 << 20, huge_pages);
+        lab_vector_naive::vector<int, mmap_allocator<int>> v(alloc);
+        v.resize(1 << 18, 5);
+        const int *first = &v[0];
+        v.push_back(6);
+        CHECK(&v[0] != first);
+        CHECK(v.capacity() == 1 << 19);
+        CHECK(v[(1 << 18) - 1] == 5);
+        CHECK(v[1 << 18] == 6);
+
+        first = &v[0];
+        v.resize(1 << 19, 7);
+        CHECK(&v[0] == first);
+        v.clear();
+        v.resize(3);
+        CHECK(v[2] == 0);
+    }
+}
+
+TEST_CASE("mmap_allocator does not extend buffers committed differently") {
+    lab_vector_naive::vector<int, mmap_allocator<int>> small_pages(
+        (mmap_allocator<int>(1 << 30))
+    );
+    small_pages.resize(10, 1);
+    const mmap_allocator<int> huge(1 << 30, true);
+    CHECK(!(small_pages.get_allocator() == huge));
+
+    lab_vector_naive::vector<int, mmap_allocator<int>> v(
+        std::move(small_pages), huge
+    );
+    CHECK(v.get_allocator().huge_pages());
+    v.resize(100'000);
+    for (std::size_t i = 0; i < v.size(); i++) {
+        v[i] = 2;
+    }
+    CHECK(v[9] == 2);
+    CHECK(v[99'999] == 2);
+}
+
+// NOLINTEND(misc-use-anonymous-namespace)
+// NOLINTEND(readability-function-cognitive-complexity)
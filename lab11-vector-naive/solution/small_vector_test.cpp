@@ -0,0 +1,130 @@
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include "doctest.h"
+#include "vector.hpp"
+
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+// NOLINTBEGIN(misc-use-anonymous-namespace)
+
+using lab_vector_naive::small_vector;
+
+namespace {
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+int small_vector_allocations = 0;
+
+template <typename T>
+struct SmallCounterAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = SmallCounterAllocator<U>;
+    };
+
+    T *allocate(std::size_t n) {
+        small_vector_allocations++;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+using counted_small_vector =
+    small_vector<std::string, 4, SmallCounterAllocator<std::string>>;
+
+bool is_inline(const counted_small_vector &v) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *object = reinterpret_cast<const char *>(&v);
+    const auto *element = reinterpret_cast<const char *>(&v[0]);
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    return object <= element && element < object + sizeof v;
+}
+}  // namespace
+
+TEST_CASE("small_vector keeps up to N elements inline") {
+    small_vector_allocations = 0;
+    counted_small_vector v;
+    CHECK(v.capacity() == 4);
+    for (int i = 0; i < 4; i++) {
+        v.push_back(std::to_string(i));
+    }
+    CHECK(small_vector_allocations == 0);
+    CHECK(v.capacity() == 4);
+    CHECK(is_inline(v));
+
+    v.push_back(v[0]);  // From itself while spilling to the heap.
+    CHECK(small_vector_allocations == 1);
+    CHECK(v.capacity() == 8);
+    CHECK(!is_inline(v));
+    CHECK(v.size() == 5);
+    for (int i = 0; i < 4; i++) {
+        CHECK(v[i] == std::to_string(i));
+    }
+    CHECK(v[4] == "0");
+}
+
+TEST_CASE("small_vector constructs inline or on the heap") {
+    small_vector_allocations = 0;
+    const counted_small_vector a(3, std::string("x"));
+    CHECK(small_vector_allocations == 0);
+    CHECK(a.capacity() == 4);
+
+    const counted_small_vector b(10);
+    CHECK(small_vector_allocations == 1);
+    CHECK(b.capacity() == 16);
+
+    const counted_small_vector c = a;
+    CHECK(small_vector_allocations == 1);
+    CHECK(c.size() == 3);
+    CHECK(c[2] == "x");
+}
+
+TEST_CASE("small_vector moves") {
+    SUBCASE("inline elements one by one") {
+        counted_small_vector orig(2, std::string(100, 'a'));
+        const counted_small_vector v = std::move(orig);
+        CHECK(v.size() == 2);
+        CHECK(v[1] == std::string(100, 'a'));
+        CHECK(is_inline(v));
+        // NOLINTBEGIN(bugprone-use-after-move,clang-analyzer-cplusplus.Move)
+        CHECK(orig.empty());
+        CHECK(orig.capacity() == 4);
+        // NOLINTEND(bugprone-use-after-move,clang-analyzer-cplusplus.Move)
+    }
+
+    SUBCASE("heap buffer without copying") {
+        counted_small_vector orig(5, std::string("b"));
+        const std::string *data = &orig[0];
+        counted_small_vector v;
+        v = std::move(orig);
+        CHECK(&v[0] == data);
+        CHECK(v.size() == 5);
+        // NOLINTBEGIN(bugprone-use-after-move,clang-analyzer-cplusplus.Move)
+        CHECK(orig.empty());
+        CHECK(orig.capacity() == 4);
+        orig.push_back("c");
+        CHECK(orig[0] == "c");
+        // NOLINTEND(bugprone-use-after-move,clang-analyzer-cplusplus.Move)
+    }
+}
+
+TEST_CASE("small_vector resize and copy-assign") {
+    counted_small_vector v(2);
+    v.resize(6, std::string("y"));
+    CHECK(v.capacity() == 8);
+    CHECK(v[1].empty());
+    CHECK(v[5] == "y");
+    v.resize(1);
+    CHECK(v.size() == 1);
+
+    counted_small_vector w(3, std::string("z"));
+    w = v;
+    CHECK(w.size() == 1);
+    CHECK(w.capacity() == 4);
+    v.resize(7, std::string("y"));
+    w = v;
+    CHECK(w.size() == 7);
+    CHECK(w.capacity() == 8);
+    CHECK(w[6] == "y");
+}
+
+// NOLINTEND(misc-use-anonymous-namespace)
+// NOLINTEND(readability-function-cognitive-complexity)
@@ -0,0 +1,51 @@
+#ifndef TRIVIALLY_RELOCATABLE_HPP_
+#define TRIVIALLY_RELOCATABLE_HPP_
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lab_vector_naive {
+// Whether moving an object and destroying the original can be replaced with
+// copying its bytes, so vectors of `T` grow with `memcpy`.  Specialize it as
+// `std::true_type` for own types which never point into themselves.
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v =
+    is_trivially_relocatable<T>::value;
+
+template <typename T1, typename T2>
+struct is_trivially_relocatable<std::pair<T1, T2>>
+    : std::bool_constant<
+          is_trivially_relocatable_v<T1> && is_trivially_relocatable_v<T2>> {
+};
+
+template <typename T>
+struct is_trivially_relocatable<std::unique_ptr<T>> : std::true_type {};
+
+template <typename T>
+struct is_trivially_relocatable<std::shared_ptr<T>> : std::true_type {};
+
+template <typename T>
+struct is_trivially_relocatable<std::weak_ptr<T>> : std::true_type {};
+
+// Checked iterators of MSVC and libstdc++ debug mode are registered in a
+// list owned by the vector, which points back at it.
+#if (!defined(_MSC_VER) || _ITERATOR_DEBUG_LEVEL == 0) && \
+    !defined(_GLIBCXX_DEBUG)
+template <typename T>
+struct is_trivially_relocatable<std::vector<T>> : std::true_type {};
+#endif
+
+#ifdef _LIBCPP_VERSION
+// Unlike libstdc++, libc++ does not point into the short string buffer.
+template <>
+struct is_trivially_relocatable<std::string> : std::true_type {};
+#endif
+}  // namespace lab_vector_naive
+
+#endif  // TRIVIALLY_RELOCATABLE_HPP_
@@ -1 +1,25 @@
-#include "vector_config.hpp"
+#ifndef VECTOR_HPP_
+#define VECTOR_HPP_
+
+#include <cstddef>
+#include <memory>
+#include "basic_vector.hpp"
+#include "vector_growth.hpp"
+
+namespace lab_vector_naive {
+template <
+    typename T,
+    typename Alloc = std::allocator<T>,
+    typename Growth = growth::power_of_two>
+using vector = basic_vector<T, 0, Alloc, Growth>;
+
+// Does not allocate while there are at most `N` elements.
+template <
+    typename T,
+    std::size_t N,
+    typename Alloc = std::allocator<T>,
+    typename Growth = growth::power_of_two>
+using small_vector = basic_vector<T, N, Alloc, Growth>;
+}  // namespace lab_vector_naive
+
+#endif  // VECTOR_HPP_
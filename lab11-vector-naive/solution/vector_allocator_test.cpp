@@ -0,0 +1,204 @@
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "doctest.h"
+#include "malloc_allocator.hpp"
+#include "vector.hpp"
+
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+// NOLINTBEGIN(misc-use-anonymous-namespace)
+
+namespace {
+struct Arena {
+    std::size_t allocated = 0;
+    std::size_t deallocated = 0;
+};
+
+// Equal only to allocators of the same arena.
+template <typename T, bool Propagate>
+struct ArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment =
+        std::bool_constant<Propagate>;
+    using propagate_on_container_move_assignment =
+        std::bool_constant<Propagate>;
+    using propagate_on_container_swap = std::bool_constant<Propagate>;
+
+    template <typename U>
+    struct rebind {
+        using other = ArenaAllocator<U, Propagate>;
+    };
+
+    explicit ArenaAllocator(Arena *arena_) : arena(arena_) {
+    }
+
+    T *allocate(std::size_t n) {
+        arena->allocated += n;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        arena->deallocated += n;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    bool operator==(const ArenaAllocator &other) const {
+        return arena == other.arena;
+    }
+
+    Arena *arena;  // NOLINT(misc-non-private-member-variables-in-classes)
+};
+
+template <bool Propagate>
+using arena_vector = lab_vector_naive::
+    vector<std::string, ArenaAllocator<std::string, Propagate>>;
+
+template <typename Growth>
+using growth_vector =
+    lab_vector_naive::vector<int, std::allocator<int>, Growth>;
+
+template <typename Growth>
+std::vector<std::size_t> capacities(std::size_t n) {
+    std::vector<std::size_t> result;
+    growth_vector<Growth> v;
+    for (std::size_t i = 0; i < n; i++) {
+        v.push_back(0);
+        if (result.empty() || result.back() != v.capacity()) {
+            result.push_back(v.capacity());
+        }
+    }
+    return result;
+}
+}  // namespace
+
+static_assert(std::is_nothrow_move_assignable_v<lab_vector_naive::vector<int>>
+);
+static_assert(std::is_nothrow_move_assignable_v<arena_vector<true>>);
+static_assert(!std::is_nothrow_move_assignable_v<arena_vector<false>>);
+
+TEST_CASE("vector keeps its allocator") {
+    Arena a;
+    Arena b;
+    {
+        using allocator = ArenaAllocator<std::string, false>;
+        arena_vector<false> from(3, std::string(100, 'x'), allocator(&a));
+        arena_vector<false> to((allocator(&b)));
+
+        SUBCASE("on copy-assignment") {
+            to = from;
+            CHECK(to.get_allocator().arena == &b);
+            CHECK(b.allocated == 4);
+        }
+
+        SUBCASE("on move-assignment, moving the elements one by one") {
+            to = std::move(from);
+            CHECK(to.get_allocator().arena == &b);
+            CHECK(b.allocated == 4);
+            // NOLINTNEXTLINE(bugprone-use-after-move)
+            CHECK(from.empty());
+        }
+        REQUIRE(to.size() == 3);
+        CHECK(to[2] == std::string(100, 'x'));
+
+        const arena_vector<false> copy = to;
+        CHECK(copy.get_allocator().arena == &b);
+    }
+    CHECK(a.allocated == a.deallocated);
+    CHECK(b.allocated == b.deallocated);
+}
+
+TEST_CASE("vector propagates its allocator") {
+    Arena a;
+    Arena b;
+    {
+        using allocator = ArenaAllocator<std::string, true>;
+        arena_vector<true> from(3, std::string(100, 'x'), allocator(&a));
+        arena_vector<true> to(5, std::string(), allocator(&b));
+
+        SUBCASE("on copy-assignment") {
+            to = from;
+            CHECK(to.get_allocator().arena == &a);
+            CHECK(a.allocated == 8);
+            CHECK(b.deallocated == 8);
+        }
+
+        SUBCASE("on move-assignment, stealing the buffer") {
+            const std::string *data = &from[0];
+            to = std::move(from);
+            CHECK(&to[0] == data);
+            CHECK(to.get_allocator().arena == &a);
+            CHECK(a.allocated == 4);
+            CHECK(b.deallocated == 8);
+        }
+
+        SUBCASE("on swap") {
+            to.swap(from);
+            CHECK(to.get_allocator().arena == &a);
+            CHECK(from.get_allocator().arena == &b);
+            CHECK(from.size() == 5);
+        }
+        REQUIRE(to.size() == 3);
+        CHECK(to[2] == std::string(100, 'x'));
+    }
+    CHECK(a.allocated == a.deallocated);
+    CHECK(b.allocated == b.deallocated);
+}
+
+TEST_CASE("growth policies") {
+    using namespace lab_vector_naive::growth;
+    CHECK(
+        capacities<power_of_two>(20) ==
+        std::vector<std::size_t>{1, 2, 4, 8, 16, 32}
+    );
+    CHECK(
+        capacities<doubling>(20) == std::vector<std::size_t>{1, 2, 4, 8, 16, 32}
+    );
+    CHECK(
+        capacities<one_and_a_half>(20) ==
+        std::vector<std::size_t>{1, 2, 3, 4, 6, 9, 13, 19, 28}
+    );
+    // 8, 16, 32, 48, 64, 80, 96, 112, 128, 160, ... bytes.
+    CHECK(
+        capacities<jemalloc_size_classes>(50) ==
+        std::vector<std::size_t>{2, 4, 8, 12, 20, 32, 48, 80}
+    );
+
+    growth_vector<page_rounded> paged;
+    paged.reserve(1000);
+    CHECK(paged.capacity() == 1000);
+    paged.reserve(1025);
+    CHECK(paged.capacity() == 2048);
+    paged.resize(2049);
+    CHECK(paged.capacity() == 4096);
+
+    growth_vector<doubling> exact(5);
+    CHECK(exact.capacity() == 5);
+}
+
+TEST_CASE("malloc_allocator grows trivially relocatable elements in place") {
+    using vector = lab_vector_naive::
+        vector<std::size_t, lab_vector_naive::malloc_allocator<std::size_t>>;
+    vector v;
+    for (std::size_t i = 0; i < 100'000; i++) {
+        v.push_back(i);
+    }
+    for (std::size_t i = 0; i < 100'000; i++) {
+        REQUIRE(v[i] == i);
+    }
+
+    vector w(4, 7);
+    w.push_back(w[3]);
+    w.resize(9, w[0]);
+    w.emplace_back(w[8]);
+    CHECK(w.size() == 10);
+    CHECK(w.capacity() == 16);
+    for (std::size_t i = 0; i < w.size(); i++) {
+        CHECK(w[i] == 7);
+    }
+}
+
+// NOLINTEND(misc-use-anonymous-namespace)
+// NOLINTEND(readability-function-cognitive-complexity)
@@ -0,0 +1,205 @@
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "doctest.h"
+#include "malloc_allocator.hpp"
+#include "vector.hpp"
+
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+// NOLINTBEGIN(misc-use-anonymous-namespace)
+
+namespace {
+using malloc_vector = lab_vector_naive::
+    vector<std::size_t, lab_vector_naive::malloc_allocator<std::size_t>>;
+
+template <typename Vector>
+concept resizable_for_overwrite =
+    requires(Vector v) { v.resize_for_overwrite(1); };
+
+template <typename Vector>
+auto elements(Vector &v) {
+    return std::span(&v[0], v.size());
+}
+
+// Trivially copyable, so vectors with `malloc_allocator` realloc it, but
+// throws when default-constructed the `fail_after`-th time.
+struct fallible {
+    static inline int fail_after = -1;
+    int value = 0;
+
+    fallible() {
+        if (fail_after >= 0 && fail_after-- == 0) {
+            throw std::runtime_error("bad default");
+        }
+    }
+
+    explicit fallible(int value_) : value(value_) {
+    }
+};
+
+// Yields `count` copies of `value` but throws instead of the fourth one.
+template <typename T>
+auto throwing_range(int count, T value) {
+    return std::views::iota(0, count) |
+           std::views::transform([value](int i) {
+               if (i == 3) {
+                   throw std::runtime_error("bad element");
+               }
+               return value;
+           });
+}
+}  // namespace
+
+static_assert(resizable_for_overwrite<lab_vector_naive::vector<char>>);
+static_assert(!resizable_for_overwrite<lab_vector_naive::vector<std::string>>
+);
+
+TEST_CASE("append_range reserves once") {
+    lab_vector_naive::vector<int> v(3, 1);
+    const std::vector<int> ints(100, 2);
+    v.append_range(ints);
+    CHECK(v.size() == 103);
+    CHECK(v.capacity() == 128);
+    CHECK(v[2] == 1);
+    CHECK(v[102] == 2);
+
+    v.append_range(std::views::iota(0, 10));
+    CHECK(v.size() == 113);
+    CHECK(v[112] == 9);
+
+    v.append_range(std::vector<int>());
+    CHECK(v.size() == 113);
+}
+
+TEST_CASE("append_range constructs elements from references") {
+    lab_vector_naive::small_vector<std::string, 4> v;
+    const std::list<std::string> strings{"a", "b", std::string(100, 'c')};
+    v.append_range(strings);
+    CHECK(v.capacity() == 4);
+    v.append_range(strings);
+    REQUIRE(v.size() == 6);
+    CHECK(v[3] == "a");
+    CHECK(v[5] == std::string(100, 'c'));
+
+    v.append_range(std::vector<const char *>{"d"});
+    CHECK(v[6] == "d");
+}
+
+TEST_CASE("append_range reads the vector itself") {
+    SUBCASE("contiguous") {
+        lab_vector_naive::vector<std::string> v(3, std::string(100, 'x'));
+        v.append_range(elements(v));
+        REQUIRE(v.size() == 6);
+        CHECK(v[5] == std::string(100, 'x'));
+    }
+
+    SUBCASE("contiguous with realloc") {
+        malloc_vector v(3, 7);
+        v.append_range(elements(v));
+        REQUIRE(v.size() == 6);
+        CHECK(v[5] == 7);
+    }
+
+    SUBCASE("through a view with realloc") {
+        malloc_vector v(3, 7);
+        v.append_range(
+            elements(v) |
+            std::views::transform([](std::size_t x) { return x + 1; })
+        );
+        REQUIRE(v.size() == 6);
+        CHECK(v[5] == 8);
+    }
+}
+
+TEST_CASE("append_range does not change the vector if iteration throws") {
+    const auto range = throwing_range(10, std::string(100, 'y'));
+
+    SUBCASE("in a new buffer") {
+        lab_vector_naive::vector<std::string> v(3, std::string(100, 'x'));
+        const std::string *data = &v[0];
+        CHECK_THROWS_AS(v.append_range(range), std::runtime_error);
+        CHECK(v.size() == 3);
+        CHECK(v.capacity() == 4);
+        CHECK(&v[0] == data);
+    }
+
+    SUBCASE("in place") {
+        lab_vector_naive::vector<std::string> v(3, std::string(100, 'x'));
+        v.reserve(16);
+        CHECK_THROWS_AS(v.append_range(range), std::runtime_error);
+        CHECK(v.size() == 3);
+        v.push_back("z");
+        CHECK(v[3] == "z");
+    }
+
+    SUBCASE("with realloc") {
+        malloc_vector v(3, 7);
+        const std::size_t *data = &v[0];
+        CHECK_THROWS_AS(
+            v.append_range(throwing_range(10, std::size_t(8))),
+            std::runtime_error
+        );
+        CHECK(v.size() == 3);
+        CHECK(v.capacity() == 4);
+        CHECK(&v[0] == data);
+    }
+}
+
+TEST_CASE("emplace_back_n") {
+    lab_vector_naive::vector<std::string> v;
+    v.emplace_back_n(3, 100, 'x');
+    REQUIRE(v.size() == 3);
+    CHECK(v[2] == std::string(100, 'x'));
+
+    v.emplace_back_n(5, v[0]);
+    CHECK(v.size() == 8);
+    CHECK(v.capacity() == 8);
+    CHECK(v[7] == std::string(100, 'x'));
+
+    v.emplace_back_n(0);
+    CHECK(v.size() == 8);
+
+    malloc_vector w(4, 7);
+    w.emplace_back_n(20, w[3]);
+    CHECK(w.size() == 24);
+    CHECK(w[23] == 7);
+}
+
+TEST_CASE("resize does not change the vector if a default element throws") {
+    lab_vector_naive::
+        vector<fallible, lab_vector_naive::malloc_allocator<fallible>>
+            v(3, fallible(7));
+    const fallible *data = &v[0];
+    fallible::fail_after = 2;
+    CHECK_THROWS_AS(v.resize(10), std::runtime_error);
+    fallible::fail_after = -1;
+    CHECK(v.size() == 3);
+    CHECK(v.capacity() == 4);
+    CHECK(&v[0] == data);
+    CHECK(v[2].value == 7);
+
+    v.resize(10);
+    CHECK(v[9].value == 0);
+}
+
+TEST_CASE("resize_for_overwrite") {
+    const char message[] = "hello, world";
+    lab_vector_naive::vector<char> v(3, '>');
+    v.resize_for_overwrite(3 + sizeof message);
+    std::memcpy(&v[3], message, sizeof message);
+    CHECK(v.size() == 3 + sizeof message);
+    CHECK(std::string(&v[3]) == message);
+    CHECK(v[0] == '>');
+
+    v.resize_for_overwrite(2);
+    CHECK(v.size() == 2);
+    CHECK(v[1] == '>');
+}
+
+// NOLINTEND(misc-use-anonymous-namespace)
+// NOLINTEND(readability-function-cognitive-complexity)
@@ -0,0 +1,462 @@
+// Benchmarks for `lab_vector_naive::vector` and `small_vector` against
+// `std::vector`.  The output mimics Google Benchmark, including its JSON
+// format, so the usual comparison tools work, but there are no external
+// dependencies.  All containers use a counting allocator, and the number of
+// allocations per iteration is reported as `allocations`.
+//
+// Build without sanitizers for meaningful numbers:
+//     cmake -S . -B build-bench -DCMAKE_BUILD_TYPE=Release -DEXTRA_CXX_FLAGS=
+//     cmake --build build-bench --target vector-bench
+//     ./build-bench/vector-bench --benchmark_out=bench.json
+//
+// Options:
+//     --benchmark_filter=<substring>  run only benchmarks containing it
+//     --benchmark_min_time=<seconds>  minimal total time per benchmark
+//     --benchmark_out=<file>          write JSON results to the file
+//     --peak_rss=<MiB>                instead, fill vectors with that many
+//                                     MiB one element at a time and print
+//                                     the peak RSS of each fill
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include "malloc_allocator.hpp"
+#include "vector.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include "mmap_allocator.hpp"
+#endif
+
+namespace lab_vector_naive {
+namespace {
+template <typename T>
+void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink = nullptr;
+    sink = &value;
+#endif
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::uint64_t allocations = 0;
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    counting_allocator() = default;
+
+    template <typename U>
+    explicit counting_allocator(const counting_allocator<U> &) {
+    }
+
+    T *allocate(std::size_t n) {
+        allocations++;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    friend bool
+    operator==(const counting_allocator &, const counting_allocator &) {
+        return true;
+    }
+};
+
+struct benchmark {
+    std::string name;
+    // Work done by a single iteration, reported as `items_per_second`.
+    std::uint64_t items;
+    std::function<void()> iteration;
+};
+
+struct result {
+    std::string name;
+    std::uint64_t iterations;
+    double real_ns;
+    double cpu_ns;
+    double items_per_second;
+    double allocations;
+};
+
+result run_benchmark(const benchmark &b, double min_time) {
+    using clock = std::chrono::steady_clock;
+    b.iteration();  // Warm up caches and the allocator.
+    for (std::uint64_t iterations = 1;; iterations *= 2) {
+        const std::uint64_t allocations_start = allocations;
+        const std::clock_t cpu_start = std::clock();
+        const clock::time_point start = clock::now();
+        for (std::uint64_t i = 0; i < iterations; i++) {
+            b.iteration();
+        }
+        const double real_s =
+            std::chrono::duration<double>(clock::now() - start).count();
+        const double cpu_s =
+            static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        if (real_s >= min_time || iterations >= (1ULL << 40)) {
+            const auto n = static_cast<double>(iterations);
+            return {
+                b.name,
+                iterations,
+                real_s * 1e9 / n,
+                cpu_s * 1e9 / n,
+                static_cast<double>(b.items) * n / real_s,
+                static_cast<double>(allocations - allocations_start) / n};
+        }
+    }
+}
+
+void write_json_string(std::ostream &os, std::string_view s) {
+    os << '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\';
+        }
+        os << c;
+    }
+    os << '"';
+}
+
+void write_json(std::ostream &os, const std::vector<result> &results) {
+    const std::time_t now = std::time(nullptr);
+    char date[32]{};
+    std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S", std::gmtime(&now));
+    os << "{\n  \"context\": {\n"
+       << "    \"date\": \"" << date << "Z\",\n"
+       << "    \"executable\": \"vector-bench\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\"\n"
+#else
+       << "    \"library_build_type\": \"debug\"\n"
+#endif
+       << "  },\n  \"benchmarks\": [";
+    bool first = true;
+    for (const result &r : results) {
+        os << (first ? "\n" : ",\n") << "    {\"name\": ";
+        first = false;
+        write_json_string(os, r.name);
+        os << ", \"run_name\": ";
+        write_json_string(os, r.name);
+        os << ", \"run_type\": \"iteration\", \"iterations\": " << r.iterations
+           << std::setprecision(17) << ", \"real_time\": " << r.real_ns
+           << ", \"cpu_time\": " << r.cpu_ns << ", \"time_unit\": \"ns\""
+           << ", \"items_per_second\": " << r.items_per_second
+           << ", \"allocations\": " << r.allocations << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+template <typename T>
+using std_vector = std::vector<T, counting_allocator<T>>;
+template <typename T>
+using lab_vector = vector<T, counting_allocator<T>>;
+template <typename T>
+using small_vector_16 = small_vector<T, 16, counting_allocator<T>>;
+
+// Fills a new vector with `n` copies of `value` one by one.
+template <template <typename> typename Vector, typename T>
+benchmark push_back(const std::string &name, std::size_t n, T value) {
+    return {
+        "push_back/" + name + "/" + std::to_string(n), n, [n, value]() {
+            Vector<T> v;
+            for (std::size_t i = 0; i < n; i++) {
+                v.push_back(value);
+            }
+            do_not_optimize(v);
+        }};
+}
+
+// Creates `n` copies of `value` and relocates them to a larger buffer once.
+template <template <typename> typename Vector, typename T>
+benchmark reserve(const std::string &name, std::size_t n, T value) {
+    return {
+        "reserve/" + name + "/" + std::to_string(n), n, [n, value]() {
+            Vector<T> v(n, value);
+            v.reserve(2 * n);
+            do_not_optimize(v);
+        }};
+}
+
+// Appends `n` bytes from a buffer to a vector holding a few bytes, like a
+// parser collecting input, one by one and in bulk.
+void add_append(std::vector<benchmark> &result, std::size_t n) {
+    const auto source = std::make_shared<std::vector<char>>(n, 'x');
+    const std::string suffix = "/" + std::to_string(n);
+    result.push_back(
+        {"append/std::vector<char>, insert" + suffix, n, [source]() {
+             std_vector<char> v(3, '>');
+             v.insert(v.end(), source->begin(), source->end());
+             do_not_optimize(v);
+         }}
+    );
+    result.push_back(
+        {"append/vector<char>, push_back" + suffix, n, [source]() {
+             lab_vector<char> v(3, '>');
+             for (const char c : *source) {
+                 v.push_back(c);
+             }
+             do_not_optimize(v);
+         }}
+    );
+    result.push_back(
+        {"append/vector<char>, append_range" + suffix, n, [source]() {
+             lab_vector<char> v(3, '>');
+             v.append_range(*source);
+             do_not_optimize(v);
+         }}
+    );
+    result.push_back(
+        {"append/vector<char>, resize_for_overwrite" + suffix, n, [source]() {
+             lab_vector<char> v(3, '>');
+             v.resize_for_overwrite(3 + source->size());
+             std::memcpy(&v[3], source->data(), source->size());
+             do_not_optimize(v);
+         }}
+    );
+}
+
+template <typename T>
+void add_push_back(
+    std::vector<benchmark> &result,
+    const std::string &type,
+    std::size_t n,
+    const T &value
+) {
+    result.push_back(
+        push_back<std_vector>("std::vector<" + type + ">", n, value)
+    );
+    result.push_back(push_back<lab_vector>("vector<" + type + ">", n, value));
+    result.push_back(
+        push_back<small_vector_16>("small_vector<" + type + ", 16>", n, value)
+    );
+}
+
+// Growth of one large vector from empty and relocation alone.
+template <typename T>
+void add_grow(
+    std::vector<benchmark> &result,
+    const std::string &type,
+    std::size_t n,
+    const T &value
+) {
+    for (benchmark b : {
+             push_back<std_vector>("std::vector<" + type + ">", n, value),
+             push_back<lab_vector>("vector<" + type + ">", n, value)}) {
+        b.name.replace(0, b.name.find('/'), "grow");
+        result.push_back(std::move(b));
+    }
+    for (const std::size_t size : {n / 100, n}) {
+        result.push_back(
+            reserve<std_vector>("std::vector<" + type + ">", size, value)
+        );
+        result.push_back(
+            reserve<lab_vector>("vector<" + type + ">", size, value)
+        );
+    }
+}
+
+std::vector<benchmark> make_benchmarks() {
+    std::vector<benchmark> result;
+    for (const std::size_t n : {4U, 16U, 64U, 4096U}) {
+        add_push_back(result, "int", n, 42);
+    }
+    for (const std::size_t n : {4U, 16U, 64U}) {
+        add_push_back(result, "std::string", n, std::string("short"));
+    }
+    for (const std::size_t n : {64U, 4096U, 1'000'000U}) {
+        add_append(result, n);
+    }
+    add_grow(result, "int", 100'000'000, 42);
+    add_grow(result, "std::string", 10'000'000, std::string("short"));
+    // Relocated with `memcpy` unlike `std::string` in libstdc++.
+    add_grow(result, "std::vector<int>", 10'000'000, std::vector<int>());
+    return result;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+template <typename T>
+struct huge_page_allocator : mmap_allocator<T> {
+    huge_page_allocator()
+        : mmap_allocator<T>(mmap_allocator<T>::default_reserved_bytes, true) {
+    }
+
+    template <typename U>
+    explicit huge_page_allocator(const huge_page_allocator<U> &other)
+        : mmap_allocator<T>(other) {
+    }
+};
+
+// Returns the peak RSS in MiB and the time in seconds of a child process
+// which appends `n` integers to a `Vector`, or a negative RSS on failure.
+template <typename Vector>
+std::pair<double, double> fill_in_child(std::size_t n) {
+    const auto start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        Vector v;
+        for (std::size_t i = 0; i < n; i++) {
+            v.push_back(i);
+        }
+        do_not_optimize(v);
+        std::_Exit(v.size() == n ? 0 : 1);
+    }
+    int status = 0;
+    rusage usage{};
+    if (pid < 0 || wait4(pid, &status, 0, &usage) != pid ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return {-1, 0};
+    }
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start
+    )
+                               .count();
+#ifdef __APPLE__
+    const double bytes_per_unit = 1;
+#else
+    const double bytes_per_unit = 1024;
+#endif
+    return {
+        static_cast<double>(usage.ru_maxrss) * bytes_per_unit / (1 << 20),
+        seconds};
+}
+
+void print_peak_rss(std::size_t mib) {
+    using element = std::uint64_t;
+    const std::size_t n = (mib << 20) / sizeof(element);
+    const std::vector<
+        std::pair<std::string, std::pair<double, double> (*)(std::size_t)>>
+        fills = {
+            {"std::vector", fill_in_child<std::vector<element>>},
+            {"vector", fill_in_child<vector<element>>},
+            {"vector, one_and_a_half",
+             fill_in_child<vector<
+                 element, std::allocator<element>, growth::one_and_a_half>>},
+            {"vector, page_rounded",
+             fill_in_child<vector<
+                 element, std::allocator<element>, growth::page_rounded>>},
+            {"vector, jemalloc_size_classes",
+             fill_in_child<vector<
+                 element, std::allocator<element>,
+                 growth::jemalloc_size_classes>>},
+            {"vector, malloc_allocator",
+             fill_in_child<vector<element, malloc_allocator<element>>>},
+            {"vector, malloc_allocator, one_and_a_half",
+             fill_in_child<vector<
+                 element, malloc_allocator<element>,
+                 growth::one_and_a_half>>},
+            {"vector, mmap_allocator",
+             fill_in_child<vector<element, mmap_allocator<element>>>},
+            {"vector, mmap_allocator, huge pages",
+             fill_in_child<vector<element, huge_page_allocator<element>>>},
+        };
+    std::cout << "Appending " << n << " 8-byte integers (" << mib
+              << " MiB)\n"
+              << std::left << std::setw(44) << "Vector" << std::right
+              << std::setw(16) << "Peak RSS, MiB" << std::setw(12)
+              << "Peak/size" << std::setw(12) << "Time, s" << '\n';
+    for (const auto &[name, fill] : fills) {
+        const auto [rss, seconds] = fill(n);
+        std::cout << std::left << std::setw(44) << name << std::right
+                  << std::fixed;
+        if (rss < 0) {
+            std::cout << std::setw(16) << "failed" << '\n';
+            continue;
+        }
+        std::cout << std::setprecision(0) << std::setw(16) << rss
+                  << std::setprecision(2) << std::setw(12)
+                  << rss / static_cast<double>(mib) << std::setw(12)
+                  << seconds << std::defaultfloat << '\n';
+    }
+}
+#else
+void print_peak_rss(std::size_t) {
+    std::cerr << "--peak_rss needs fork() and wait4()\n";
+}
+#endif
+}  // namespace
+}  // namespace lab_vector_naive
+
+int main(int argc, char *argv[]) {
+    using namespace std::string_view_literals;
+    std::string filter;
+    std::string out_file;
+    double min_time = 0.5;
+    std::size_t peak_rss_mib = 0;
+    for (const std::string_view arg :
+         std::vector<std::string_view>(argv + 1, argv + argc)) {
+        const auto value_of = [&](std::string_view flag) {
+            return arg.substr(flag.size());
+        };
+        if (arg.starts_with("--benchmark_filter="sv)) {
+            filter = value_of("--benchmark_filter="sv);
+        } else if (arg.starts_with("--benchmark_out="sv)) {
+            out_file = value_of("--benchmark_out="sv);
+        } else if (arg.starts_with("--benchmark_min_time="sv)) {
+            min_time =
+                std::stod(std::string(value_of("--benchmark_min_time="sv)));
+        } else if (arg.starts_with("--peak_rss="sv)) {
+            peak_rss_mib = std::stoul(std::string(value_of("--peak_rss="sv)));
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--benchmark_filter=<substring>]"
+                         " [--benchmark_min_time=<seconds>]"
+                         " [--benchmark_out=<file.json>]"
+                         " [--peak_rss=<MiB>]\n";
+            return 1;
+        }
+    }
+    if (peak_rss_mib != 0) {
+        lab_vector_naive::print_peak_rss(peak_rss_mib);
+        return 0;
+    }
+
+    std::vector<lab_vector_naive::result> results;
+    std::cout << std::left << std::setw(44) << "Benchmark" << std::right
+              << std::setw(14) << "Time, ns" << std::setw(14) << "CPU, ns"
+              << std::setw(14) << "Iterations" << std::setw(14) << "items/s"
+              << std::setw(8) << "allocs" << '\n';
+    for (const auto &b : lab_vector_naive::make_benchmarks()) {
+        if (b.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        const auto &r =
+            results.emplace_back(lab_vector_naive::run_benchmark(b, min_time));
+        std::cout << std::left << std::setw(44) << r.name << std::right
+                  << std::fixed << std::setprecision(0) << std::setw(14)
+                  << r.real_ns << std::setw(14) << r.cpu_ns << std::setw(14)
+                  << r.iterations << std::setw(14) << std::scientific
+                  << std::setprecision(3) << r.items_per_second << std::fixed
+                  << std::setprecision(1) << std::setw(8) << r.allocations
+                  << std::defaultfloat << '\n';
+    }
+
+    if (!out_file.empty()) {
+        std::ofstream out(out_file);
+        if (!out) {
+            std::cerr << "Unable to open file '" << out_file << "'\n";
+            return 1;
+        }
+        lab_vector_naive::write_json(out, results);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef VECTOR_GROWTH_HPP_
+#define VECTOR_GROWTH_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include "vector_config.hpp"
+
+namespace lab_vector_naive {
+// How much a vector grows when it runs out of capacity.  `next_capacity`
+// returns at least `needed` elements of `element_size` bytes for a vector
+// with `current` capacity, which is 0 for `reserve` and constructors.
+namespace growth {
+// The least power of two fitting the elements.
+struct power_of_two {
+    static std::size_t
+    next_capacity(std::size_t, std::size_t needed, std::size_t)
+        VECTOR_NOEXCEPT {
+        return std::bit_ceil(needed);
+    }
+};
+
+struct doubling {
+    static std::size_t
+    next_capacity(std::size_t current, std::size_t needed, std::size_t)
+        VECTOR_NOEXCEPT {
+        return std::max(needed, 2 * current);
+    }
+};
+
+// Lets the allocator reuse the freed buffers of earlier steps.
+struct one_and_a_half {
+    static std::size_t
+    next_capacity(std::size_t current, std::size_t needed, std::size_t)
+        VECTOR_NOEXCEPT {
+        return std::max(needed, current + current / 2);
+    }
+};
+
+// Doubles and then fills whole 4 KiB pages, which large allocations take
+// anyway.
+struct page_rounded {
+    static constexpr std::size_t page_size = 4096;
+
+    static std::size_t next_capacity(
+        std::size_t current,
+        std::size_t needed,
+        std::size_t element_size
+    ) VECTOR_NOEXCEPT {
+        const std::size_t capacity = std::max(needed, 2 * current);
+        if (capacity * element_size < page_size) {
+            return capacity;
+        }
+        return (capacity * element_size + page_size - 1) / page_size *
+               page_size / element_size;
+    }
+};
+
+// Grows by 1.5 and then fills the size class which jemalloc rounds the
+// allocation up to.
+struct jemalloc_size_classes {
+    static std::size_t next_capacity(
+        std::size_t current,
+        std::size_t needed,
+        std::size_t element_size
+    ) VECTOR_NOEXCEPT {
+        const std::size_t capacity = std::max(needed, current + current / 2);
+        return size_class(capacity * element_size) / element_size;
+    }
+
+    // 8 bytes, multiples of 16 up to 128 bytes, then four classes between
+    // consecutive powers of two.
+    static std::size_t size_class(std::size_t bytes) VECTOR_NOEXCEPT {
+        if (bytes <= 8) {
+            return 8;
+        }
+        if (bytes <= 128) {
+            return (bytes + 15) / 16 * 16;
+        }
+        const std::size_t step = std::bit_floor(bytes - 1) / 4;
+        return (bytes + step - 1) / step * step;
+    }
+};
+}  // namespace growth
+}  // namespace lab_vector_naive
+
+#endif  // VECTOR_GROWTH_HPP_
@@ -0,0 +1,90 @@
+#include <memory>
+#include <string>
+#include <utility>
+#include "doctest.h"
+#include "vector.hpp"
+
+// NOLINTBEGIN(misc-use-anonymous-namespace)
+
+namespace {
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+int relocatable_moves = 0;
+
+struct Relocatable {
+    std::unique_ptr<int> value;
+
+    explicit Relocatable(int v) : value(std::make_unique<int>(v)) {
+    }
+
+    Relocatable(Relocatable &&other) noexcept : value(std::move(other.value)) {
+        relocatable_moves++;
+    }
+
+    Relocatable(const Relocatable &) = delete;
+    Relocatable &operator=(const Relocatable &) = delete;
+    Relocatable &operator=(Relocatable &&) = delete;
+    ~Relocatable() = default;
+};
+
+struct PointsToItself {
+    PointsToItself *self = this;
+
+    PointsToItself() = default;
+
+    PointsToItself(const PointsToItself &) {
+    }
+
+    PointsToItself &operator=(const PointsToItself &) {
+        return *this;
+    }
+
+    ~PointsToItself() = default;
+};
+}  // namespace
+
+template <>
+struct lab_vector_naive::is_trivially_relocatable<Relocatable>
+    : std::true_type {};
+
+using lab_vector_naive::is_trivially_relocatable_v;
+
+static_assert(is_trivially_relocatable_v<int>);
+static_assert(is_trivially_relocatable_v<std::pair<int, double>>);
+static_assert(is_trivially_relocatable_v<std::unique_ptr<std::string>>);
+static_assert(is_trivially_relocatable_v<lab_vector_naive::vector<std::string>>
+);
+static_assert(!is_trivially_relocatable_v<PointsToItself>);
+static_assert(!is_trivially_relocatable_v<
+              lab_vector_naive::small_vector<std::string, 2>>);
+
+TEST_CASE("trivially relocatable elements are not moved on growth") {
+    relocatable_moves = 0;
+    lab_vector_naive::vector<Relocatable> v;
+    for (int i = 0; i < 100; i++) {
+        v.push_back(Relocatable(i));
+    }
+    CHECK(relocatable_moves == 100);  // Only into the vector.
+    v.reserve(1000);
+    CHECK(relocatable_moves == 100);
+    for (int i = 0; i < 100; i++) {
+        CHECK(*v[i].value == i);
+    }
+}
+
+TEST_CASE("vectors of vectors grow without moving inner buffers") {
+    lab_vector_naive::vector<lab_vector_naive::vector<int>> v;
+    v.push_back(lab_vector_naive::vector<int>(3, 7));
+    const int *inner = &v[0][0];
+    v.resize(100);
+    CHECK(&v[0][0] == inner);
+    CHECK(v[0][2] == 7);
+    CHECK(v[99].empty());
+}
+
+TEST_CASE("elements pointing to themselves are moved") {
+    lab_vector_naive::vector<PointsToItself> v(1);
+    v.reserve(100);
+    CHECK(v[0].self == &v[0]);
+}
+
+// NOLINTEND(misc-use-anonymous-namespace)